@@ -0,0 +1,230 @@
+/*--------------------------------------------------------------------*/
+/* archive.c                                                          */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for O_CLOEXEC */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "archive.h"
+
+/*--------------------------------------------------------------------*/
+
+/* A file mapped into memory. */
+struct Mapping {
+   /* The bytes of the file, or NULL if it is empty. */
+   const unsigned char *pucData;
+
+   /* The length of the file. */
+   size_t ulSize;
+};
+
+struct Archive {
+   /* The archive and its index. */
+   struct Mapping sRecords;
+   struct Mapping sIndex;
+
+   /* The entries of the index, and how many there are. */
+   const struct Record_Index *psEntries;
+   long lCount;
+};
+
+/*--------------------------------------------------------------------*/
+/* Maps the file pcFile into memory, read only, and stores it in
+   *psMapping. Returns 1 if successful and 0 if not. */
+
+static int mapFile(const char *pcFile, struct Mapping *psMapping) {
+
+   struct stat sStat;
+   void *pvData;
+   int iFd;
+
+   psMapping->pucData = NULL;
+   psMapping->ulSize = 0;
+
+   iFd = open(pcFile, O_RDONLY | O_CLOEXEC);
+   if (iFd == -1) return 0;
+   if (fstat(iFd, &sStat) == -1) {
+      close(iFd);
+      return 0;
+   }
+   if (sStat.st_size == 0) {
+      close(iFd);
+      return 1;
+   }
+   pvData = mmap(NULL, (size_t)sStat.st_size, PROT_READ, MAP_SHARED, iFd,
+                 0);
+   close(iFd);
+   if (pvData == MAP_FAILED) return 0;
+   psMapping->pucData = pvData;
+   psMapping->ulSize = (size_t)sStat.st_size;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Unmaps the file of *psMapping. */
+
+static void unmapFile(struct Mapping *psMapping) {
+   if (psMapping->pucData != NULL)
+      munmap((void *)psMapping->pucData, psMapping->ulSize);
+}
+
+/*--------------------------------------------------------------------*/
+Archive_T Archive_open(const char *pcFile) {
+
+   Archive_T oArchive;
+   const struct Record_Index *psLast;
+   char *pcIndex;
+   int iOk;
+
+   assert(pcFile != NULL);
+
+   oArchive = (Archive_T)calloc(1, sizeof(struct Archive));
+   if (oArchive == NULL) return NULL;
+   pcIndex = Record_indexName(pcFile);
+   if (pcIndex == NULL) {
+      free(oArchive);
+      return NULL;
+   }
+   iOk = mapFile(pcFile, &oArchive->sRecords);
+   if (iOk == 1) iOk = mapFile(pcIndex, &oArchive->sIndex);
+   free(pcIndex);
+
+   /* A crash or a full disk may leave part of an entry at the end of
+      the index, or entries whose records are not all in the archive,
+      or records after the last entry. Only the whole entries of whole
+      records are used; records come in the order of their entries, so
+      those are the ones before the first that is not. */
+   if (iOk == 1) {
+      oArchive->psEntries =
+         (const struct Record_Index *)oArchive->sIndex.pucData;
+      oArchive->lCount = (long)(oArchive->sIndex.ulSize
+                                / sizeof(struct Record_Index));
+      while (oArchive->lCount > 0) {
+         psLast = &oArchive->psEntries[oArchive->lCount - 1];
+         if (psLast->uOffset + psLast->uLength
+             <= oArchive->sRecords.ulSize)
+            break;
+         oArchive->lCount--;
+      }
+   }
+   if (iOk == 0) {
+      Archive_close(oArchive);
+      return NULL;
+   }
+   return oArchive;
+}
+
+/*--------------------------------------------------------------------*/
+void Archive_close(Archive_T oArchive) {
+
+   assert(oArchive != NULL);
+
+   unmapFile(&oArchive->sRecords);
+   unmapFile(&oArchive->sIndex);
+   free(oArchive);
+}
+
+/*--------------------------------------------------------------------*/
+long Archive_getCount(Archive_T oArchive) {
+   assert(oArchive != NULL);
+   return oArchive->lCount;
+}
+
+/*--------------------------------------------------------------------*/
+const struct Record_Index *Archive_getIndex(Archive_T oArchive,
+                                            long lGame) {
+   assert(oArchive != NULL);
+   assert(lGame >= 0 && lGame < oArchive->lCount);
+   return &oArchive->psEntries[lGame];
+}
+
+/*--------------------------------------------------------------------*/
+int Archive_getGame(Archive_T oArchive, long lGame,
+                    struct Record_Game *psGame) {
+
+   const struct Record_Index *psEntry;
+
+   assert(oArchive != NULL);
+   assert(lGame >= 0 && lGame < oArchive->lCount);
+   assert(psGame != NULL);
+
+   psEntry = &oArchive->psEntries[lGame];
+   if (psEntry->uOffset + psEntry->uLength > oArchive->sRecords.ulSize)
+      return 0;
+   return Record_decode(oArchive->sRecords.pucData + psEntry->uOffset,
+                        psEntry->uLength, psGame) == psEntry->uLength;
+}
+
+/*--------------------------------------------------------------------*/
+long Archive_findPlayer(Archive_T oArchive, const char *pcName,
+                        long lFrom) {
+
+   struct Record_Game sGame;
+   uint32_t uHash;
+   long lGame;
+
+   assert(oArchive != NULL);
+   assert(pcName != NULL);
+
+   uHash = Record_hashName(pcName);
+   for (lGame = lFrom; lGame < oArchive->lCount; lGame++) {
+      if (oArchive->psEntries[lGame].uPlayer1 != uHash
+          && oArchive->psEntries[lGame].uPlayer2 != uHash)
+         continue;
+
+      /* Rule out another name with the same hash. */
+      if (Archive_getGame(oArchive, lGame, &sGame) == 1
+          && (strcmp(sGame.acPlayer1, pcName) == 0
+              || strcmp(sGame.acPlayer2, pcName) == 0))
+         return lGame;
+   }
+   return -1;
+}
+
+/*--------------------------------------------------------------------*/
+long Archive_reindex(const char *pcFile, unsigned long *pulEnd) {
+
+   struct Mapping sRecords;
+   struct Record_Game sGame;
+   struct Record_Index sIndex;
+   FILE *psIndex;
+   char *pcIndex;
+   size_t ulOffset, ulLength;
+   long lCount;
+
+   assert(pcFile != NULL);
+   assert(pulEnd != NULL);
+
+   if (mapFile(pcFile, &sRecords) == 0) return -1;
+   pcIndex = Record_indexName(pcFile);
+   if (pcIndex == NULL) {
+      unmapFile(&sRecords);
+      return -1;
+   }
+   psIndex = fopen(pcIndex, "wb");
+   free(pcIndex);
+   if (psIndex == NULL) {
+      unmapFile(&sRecords);
+      return -1;
+   }
+
+   lCount = 0;
+   for (ulOffset = 0; ulOffset < sRecords.ulSize; ulOffset += ulLength) {
+      ulLength = Record_decode(sRecords.pucData + ulOffset,
+                               sRecords.ulSize - ulOffset, &sGame);
+      if (ulLength == 0) break;
+      Record_makeIndex(&sGame, (unsigned long)ulOffset, ulLength,
+                       &sIndex);
+      if (fwrite(&sIndex, sizeof(sIndex), 1, psIndex) != 1) {
+         lCount = -1;
+         break;
+      }
+      lCount++;
+   }
+   *pulEnd = (unsigned long)ulOffset;
+   if (fclose(psIndex) != 0) lCount = -1;
+   unmapFile(&sRecords);
+   return lCount;
+}
+/*--------------------------------------------------------------------*/
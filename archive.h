@@ -0,0 +1,54 @@
+/*--------------------------------------------------------------------*/
+/* archive.h                                                          */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef ARCHIVE_INCLUDED
+#define ARCHIVE_INCLUDED
+
+#include "record.h"
+
+/* An Archive is an archive of game records and its index, written by
+   a Record_T, mapped into memory to be read. Opening one reads
+   nothing: game n is found through entry n of the index, and the
+   games of a player by comparing the hashes in the index, so even an
+   archive of millions of games is searched without parsing it. */
+
+typedef struct Archive *Archive_T;
+
+/* Maps the archive pcFile and its index into memory. Index entries
+   whose records go past the end of the archive are left out. Returns
+   the archive, or NULL if either cannot be mapped. */
+Archive_T Archive_open(const char *pcFile);
+
+/* Unmaps oArchive and frees it. */
+void Archive_close(Archive_T oArchive);
+
+/* Returns the number of games in oArchive. */
+long Archive_getCount(Archive_T oArchive);
+
+/* Returns the index entry of game number lGame of oArchive, counting
+   from 0. */
+const struct Record_Index *Archive_getIndex(Archive_T oArchive,
+                                            long lGame);
+
+/* Reads game number lGame of oArchive, counting from 0, into *psGame.
+   Returns 1 if successful and 0 if its record is damaged. */
+int Archive_getGame(Archive_T oArchive, long lGame,
+                    struct Record_Game *psGame);
+
+/* Returns the number of the first game of oArchive from lFrom on that
+   player pcName played, as FIRST or SECOND, or -1 if there is none.
+   Only games whose index has the hash of pcName are read. */
+long Archive_findPlayer(Archive_T oArchive, const char *pcName,
+                        long lFrom);
+
+/* Writes a new index for the archive pcFile by reading its records,
+   for an archive whose index is missing or damaged. Every record up
+   to the first one that cannot be read is indexed, and *pulEnd is
+   set to the byte where that one starts, which is the size of the
+   archive if all of them can be read. The archive itself is not
+   changed. Returns the number of games indexed, or -1 if the archive
+   cannot be read or the index cannot be written. */
+long Archive_reindex(const char *pcFile, unsigned long *pulEnd);
+
+#endif
@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------*/
+/* batch.c                                                            */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for sysconf */
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "batch.h"
+#include "bitboard.h"
+
+/* Fewest positions worth a thread of their own. */
+enum {THREAD_POSITIONS = 1 << 14};
+
+/* Most threads. */
+enum {MAX_THREADS = 256};
+
+/*--------------------------------------------------------------------*/
+
+/* The share of a batch done by one thread. */
+struct Share {
+   const struct Batch_Position *psPositions;
+   const struct Batch_Output *psOutput;
+
+   /* The positions of the share: from ulStart up to ulEnd. */
+   size_t ulStart;
+   size_t ulEnd;
+};
+
+/*--------------------------------------------------------------------*/
+/* Looks at the positions of the struct Share pvShare and stores what
+   it finds. Returns NULL. */
+
+static void *evaluateShare(void *pvShare) {
+
+   const struct Share *psShare;
+   const struct Batch_Output *psOutput;
+   uint64_t uOwn, uOpp, uMoves, uOppMoves;
+   size_t i;
+   int iStatus;
+
+   psShare = (const struct Share *)pvShare;
+   psOutput = psShare->psOutput;
+   for (i = psShare->ulStart; i < psShare->ulEnd; i++) {
+      uOwn = psShare->psPositions[i].uOwn;
+      uOpp = psShare->psPositions[i].uOpp;
+      uMoves = Bitboard_legalMoves(uOwn, uOpp);
+
+      /* The other player's moves are only needed for a count, or to
+         tell a pass from the end of the game. */
+      uOppMoves = 0;
+      if (psOutput->pucOppMobility != NULL
+          || (psOutput->pucStatus != NULL && uMoves == 0))
+         uOppMoves = Bitboard_legalMoves(uOpp, uOwn);
+
+      if (psOutput->puMoves != NULL) psOutput->puMoves[i] = uMoves;
+      if (psOutput->pucMobility != NULL)
+         psOutput->pucMobility[i] = (uint8_t)Bitboard_count(uMoves);
+      if (psOutput->pucOppMobility != NULL)
+         psOutput->pucOppMobility[i] =
+            (uint8_t)Bitboard_count(uOppMoves);
+      if (psOutput->pucTiles != NULL)
+         psOutput->pucTiles[i] = (uint8_t)Bitboard_count(uOwn);
+      if (psOutput->pucOppTiles != NULL)
+         psOutput->pucOppTiles[i] = (uint8_t)Bitboard_count(uOpp);
+      if (psOutput->pucStatus != NULL) {
+         if (uMoves != 0) iStatus = BATCH_MOVE;
+         else if (uOppMoves != 0) iStatus = BATCH_PASS;
+         else iStatus = BATCH_OVER;
+         psOutput->pucStatus[i] = (uint8_t)iStatus;
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+void Batch_evaluate(const struct Batch_Position *psPositions,
+                    size_t ulCount, const struct Batch_Output *psOutput,
+                    int iThreads) {
+
+   struct Share asShares[MAX_THREADS];
+   pthread_t aiThreads[MAX_THREADS];
+   int i, iStarted;
+
+   assert(psPositions != NULL || ulCount == 0);
+   assert(psOutput != NULL);
+   assert(iThreads >= 0);
+
+   if (iThreads == 0) iThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   if (iThreads > MAX_THREADS) iThreads = MAX_THREADS;
+   if ((size_t)iThreads > ulCount / THREAD_POSITIONS)
+      iThreads = (int)(ulCount / THREAD_POSITIONS);
+   if (iThreads < 1) iThreads = 1;
+
+   /* Give each thread a run of positions of its own, so that no two
+      write to the same cache line but at the ends of their runs. */
+   for (i = 0; i < iThreads; i++) {
+      asShares[i].psPositions = psPositions;
+      asShares[i].psOutput = psOutput;
+      asShares[i].ulStart = ulCount / (size_t)iThreads * (size_t)i;
+      asShares[i].ulEnd = ulCount / (size_t)iThreads * (size_t)(i + 1);
+   }
+   asShares[iThreads - 1].ulEnd = ulCount;
+
+   /* The calling thread does the first share itself, and any share
+      whose thread cannot be started. */
+   for (iStarted = 1; iStarted < iThreads; iStarted++)
+      if (pthread_create(&aiThreads[iStarted], NULL, evaluateShare,
+                         &asShares[iStarted]) != 0)
+         break;
+   evaluateShare(&asShares[0]);
+   for (i = iStarted; i < iThreads; i++) evaluateShare(&asShares[i]);
+   for (i = 1; i < iStarted; i++) pthread_join(aiThreads[i], NULL);
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,59 @@
+/*--------------------------------------------------------------------*/
+/* batch.h                                                            */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The batch functions look at many positions at once, for analysing
+   archives of games. Positions are packed into an array of struct
+   Batch_Position instead of each being a Board_T, and what is found
+   out about them is stored in arrays the caller provides. Nothing is
+   allocated per position, and the array is shared out between
+   threads. */
+
+/* A position, packed into two bitboards (see bitboard.h). */
+struct Batch_Position {
+   /* The tiles of the player to move. */
+   uint64_t uOwn;
+
+   /* The tiles of the other player. */
+   uint64_t uOpp;
+};
+
+/* Whether the player to move in a position can move, has to pass or
+   the game is over. */
+enum Batch_Status {BATCH_MOVE, BATCH_PASS, BATCH_OVER};
+
+/* Where to store what is found out about positions. Entry i of each
+   array is for position i. Arrays that are NULL are not filled. */
+struct Batch_Output {
+   /* The legal moves of the player to move, as a bitboard. */
+   uint64_t *puMoves;
+
+   /* The number of legal moves of the player to move and of the other
+      player. */
+   uint8_t *pucMobility;
+   uint8_t *pucOppMobility;
+
+   /* The number of tiles of the player to move and of the other
+      player. */
+   uint8_t *pucTiles;
+   uint8_t *pucOppTiles;
+
+   /* The enum Batch_Status of the position. */
+   uint8_t *pucStatus;
+};
+
+/* Looks at the ulCount positions in psPositions and stores what it
+   finds in the arrays of *psOutput, with iThreads threads, or one per
+   processor if iThreads is 0. Small batches are done by the calling
+   thread alone, as is everything if no thread can be started. */
+void Batch_evaluate(const struct Batch_Position *psPositions,
+                    size_t ulCount, const struct Batch_Output *psOutput,
+                    int iThreads);
+
+#endif
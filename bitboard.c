@@ -0,0 +1,317 @@
+/*--------------------------------------------------------------------*/
+/* bitboard.c                                                         */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#include <string.h>
+#include <assert.h>
+#include "bitboard.h"
+
+/* The SSE2 and AVX2 flip kernels are built with GCC target attributes
+   and picked at run time from what the processor supports. Elsewhere
+   only the portable kernel is built. */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BITBOARD_X86 1
+#include <immintrin.h>
+#endif
+
+/* Longest run of the other player's tiles that a move can flip. */
+enum {MAX_RUN = 6};
+
+/* Every tile except the ones in column A (0) and column H (7). These
+   mask out the tiles that wrap around to the other side of the board
+   when a bitboard is shifted sideways. */
+#define NOT_A_FILE 0xFEFEFEFEFEFEFEFEULL
+#define NOT_H_FILE 0x7F7F7F7F7F7F7F7FULL
+#define INNER_FILES 0x7E7E7E7E7E7E7E7EULL
+
+/*--------------------------------------------------------------------*/
+/* Returns the empty or other tiles just past a run of uMask tiles
+   that starts next to a tile of uOwn, in both directions along which
+   a bitboard is shifted iShift places to move one tile. uMask must
+   leave out the tiles of columns A and H unless iShift is 8, so that
+   no run wraps around the board. A run is at most six tiles long, so
+   two single steps and two double steps cover it. */
+
+static uint64_t Bitboard_movesAlong(uint64_t uOwn, uint64_t uMask,
+                                    int iShift) {
+
+   uint64_t uLeft, uRight, uMaskLeft, uMaskRight;
+
+   uLeft = uMask & (uOwn << iShift);
+   uRight = uMask & (uOwn >> iShift);
+   uLeft |= uMask & (uLeft << iShift);
+   uRight |= uMask & (uRight >> iShift);
+   uMaskLeft = uMask & (uMask << iShift);
+   uMaskRight = uMaskLeft >> iShift;
+   uLeft |= uMaskLeft & (uLeft << (2 * iShift));
+   uRight |= uMaskRight & (uRight >> (2 * iShift));
+   uLeft |= uMaskLeft & (uLeft << (2 * iShift));
+   uRight |= uMaskRight & (uRight >> (2 * iShift));
+   return (uLeft << iShift) | (uRight >> iShift);
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Bitboard_legalMoves(uint64_t uOwn, uint64_t uOpp) {
+
+   uint64_t uInner;
+
+   /* Grow runs of the other player's tiles out of every tile of the
+      current player at once, two opposite directions at a time. An
+      empty tile just past the end of a run is a legal move. */
+   uInner = uOpp & INNER_FILES;
+   return (Bitboard_movesAlong(uOwn, uInner, 1)
+           | Bitboard_movesAlong(uOwn, uOpp, 8)
+           | Bitboard_movesAlong(uOwn, uInner, 7)
+           | Bitboard_movesAlong(uOwn, uInner, 9))
+      & ~(uOwn | uOpp);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the run of uOpp tiles that starts next to uMove in the
+   direction reached by shifting iShift places left, if a tile of uOwn
+   closes it off, or 0 if none does. uWrap holds the tiles that are
+   still on the board after such a shift. Does not branch on the
+   contents of the board. */
+
+static inline uint64_t Bitboard_flipsLeft(uint64_t uMove, uint64_t uOwn,
+                                          uint64_t uOpp, int iShift,
+                                          uint64_t uWrap) {
+   uint64_t uRun;
+
+   uOpp &= uWrap;
+   uRun = (uMove << iShift) & uOpp;
+   uRun |= (uRun << iShift) & uOpp;
+   uRun |= (uRun << iShift) & uOpp;
+   uRun |= (uRun << iShift) & uOpp;
+   uRun |= (uRun << iShift) & uOpp;
+   uRun |= (uRun << iShift) & uOpp;
+   return uRun & (0 - (uint64_t)(((uRun << iShift) & uOwn & uWrap) != 0));
+}
+
+/*--------------------------------------------------------------------*/
+/* Same as Bitboard_flipsLeft() for the direction reached by shifting
+   iShift places right. */
+
+static inline uint64_t Bitboard_flipsRight(uint64_t uMove, uint64_t uOwn,
+                                           uint64_t uOpp, int iShift,
+                                           uint64_t uWrap) {
+   uint64_t uRun;
+
+   uOpp &= uWrap;
+   uRun = (uMove >> iShift) & uOpp;
+   uRun |= (uRun >> iShift) & uOpp;
+   uRun |= (uRun >> iShift) & uOpp;
+   uRun |= (uRun >> iShift) & uOpp;
+   uRun |= (uRun >> iShift) & uOpp;
+   uRun |= (uRun >> iShift) & uOpp;
+   return uRun & (0 - (uint64_t)(((uRun >> iShift) & uOwn & uWrap) != 0));
+}
+
+/*--------------------------------------------------------------------*/
+/* The portable flip kernel. Works out all 8 directions one after the
+   other in plain 64-bit arithmetic. */
+
+static uint64_t Bitboard_flipsScalar(uint64_t uOwn, uint64_t uOpp,
+                                     int iSquare) {
+   uint64_t uMove = (uint64_t)1 << iSquare;
+
+   return Bitboard_flipsLeft(uMove, uOwn, uOpp, 1, NOT_A_FILE)
+      | Bitboard_flipsLeft(uMove, uOwn, uOpp, 7, NOT_H_FILE)
+      | Bitboard_flipsLeft(uMove, uOwn, uOpp, 8, ~0ULL)
+      | Bitboard_flipsLeft(uMove, uOwn, uOpp, 9, NOT_A_FILE)
+      | Bitboard_flipsRight(uMove, uOwn, uOpp, 1, NOT_H_FILE)
+      | Bitboard_flipsRight(uMove, uOwn, uOpp, 7, NOT_A_FILE)
+      | Bitboard_flipsRight(uMove, uOwn, uOpp, 8, ~0ULL)
+      | Bitboard_flipsRight(uMove, uOwn, uOpp, 9, NOT_H_FILE);
+}
+
+#ifdef BITBOARD_X86
+/*--------------------------------------------------------------------*/
+/* Returns the lanes of vRun whose tile just past the end, found by
+   shifting vRun iShift places left and keeping vWrap, belongs to
+   vOwn. The other lanes are cleared. SSE2 has no 64-bit compare, so
+   a lane is zero when both of its 32-bit halves are. */
+
+__attribute__((target("sse2")))
+static inline __m128i Bitboard_closedSse2(__m128i vRun, __m128i vOwn,
+                                          int iShift, __m128i vWrap) {
+   __m128i vEnd, vZero;
+
+   vEnd = _mm_and_si128(_mm_and_si128(_mm_slli_epi64(vRun, iShift),
+                                      vOwn), vWrap);
+   vZero = _mm_cmpeq_epi32(vEnd, _mm_setzero_si128());
+   vZero = _mm_and_si128(vZero, _mm_shuffle_epi32(vZero,
+                                                  _MM_SHUFFLE(2, 3, 0, 1)));
+   return _mm_andnot_si128(vZero, vRun);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the flips in the two directions reached by shifting iShift
+   places left in the board of lane 0 and the upside down board of
+   lane 1. */
+
+__attribute__((target("sse2")))
+static inline __m128i Bitboard_flipsSse2Pair(__m128i vMove, __m128i vOwn,
+                                             __m128i vOpp, int iShift,
+                                             uint64_t uWrap) {
+   __m128i vWrap, vRun;
+
+   vWrap = _mm_set1_epi64x((long long)uWrap);
+   vOpp = _mm_and_si128(vOpp, vWrap);
+   vRun = _mm_and_si128(_mm_slli_epi64(vMove, iShift), vOpp);
+   vRun = _mm_or_si128(vRun, _mm_and_si128(_mm_slli_epi64(vRun, iShift),
+                                           vOpp));
+   vRun = _mm_or_si128(vRun, _mm_and_si128(_mm_slli_epi64(vRun, iShift),
+                                           vOpp));
+   vRun = _mm_or_si128(vRun, _mm_and_si128(_mm_slli_epi64(vRun, iShift),
+                                           vOpp));
+   vRun = _mm_or_si128(vRun, _mm_and_si128(_mm_slli_epi64(vRun, iShift),
+                                           vOpp));
+   vRun = _mm_or_si128(vRun, _mm_and_si128(_mm_slli_epi64(vRun, iShift),
+                                           vOpp));
+   return Bitboard_closedSse2(vRun, vOwn, iShift, vWrap);
+}
+
+/*--------------------------------------------------------------------*/
+/* The SSE2 flip kernel. Lane 1 holds the board turned upside down,
+   where a shift left goes north instead of south, so three paired
+   shifts cover the six directions that are not along the row. The
+   two directions along the row are worked out in plain arithmetic. */
+
+__attribute__((target("sse2")))
+static uint64_t Bitboard_flipsSse2(uint64_t uOwn, uint64_t uOpp,
+                                   int iSquare) {
+   uint64_t uMove = (uint64_t)1 << iSquare;
+   uint64_t auLanes[2];
+   __m128i vMove, vOwn, vOpp, vFlips;
+
+   vMove = _mm_set_epi64x((long long)__builtin_bswap64(uMove),
+                          (long long)uMove);
+   vOwn = _mm_set_epi64x((long long)__builtin_bswap64(uOwn),
+                         (long long)uOwn);
+   vOpp = _mm_set_epi64x((long long)__builtin_bswap64(uOpp),
+                         (long long)uOpp);
+
+   vFlips = Bitboard_flipsSse2Pair(vMove, vOwn, vOpp, 7, NOT_H_FILE);
+   vFlips = _mm_or_si128(vFlips, Bitboard_flipsSse2Pair(vMove, vOwn, vOpp,
+                                                        8, ~0ULL));
+   vFlips = _mm_or_si128(vFlips, Bitboard_flipsSse2Pair(vMove, vOwn, vOpp,
+                                                        9, NOT_A_FILE));
+   _mm_storeu_si128((__m128i *)auLanes, vFlips);
+
+   return auLanes[0] | __builtin_bswap64(auLanes[1])
+      | Bitboard_flipsLeft(uMove, uOwn, uOpp, 1, NOT_A_FILE)
+      | Bitboard_flipsRight(uMove, uOwn, uOpp, 1, NOT_H_FILE);
+}
+
+/*--------------------------------------------------------------------*/
+/* The AVX2 flip kernel. Each of the four 64-bit lanes follows one
+   direction, with a per-lane shift, so one pass of left shifts and
+   one pass of right shifts cover all 8 directions. */
+
+__attribute__((target("avx2")))
+static uint64_t Bitboard_flipsAvx2(uint64_t uOwn, uint64_t uOpp,
+                                   int iSquare) {
+   __m256i vShift, vMove, vOwn, vOpp;
+   __m256i vWrapL, vWrapR, vOppL, vOppR;
+   __m256i vRunL, vRunR, vEndL, vEndR, vZero, vFlips;
+   __m128i vHalf;
+   int i;
+
+   /* East, south, southeast and southwest to the left; west, north,
+      northwest and northeast to the right. */
+   vShift = _mm256_set_epi64x(7, 9, 8, 1);
+   vWrapL = _mm256_set_epi64x((long long)NOT_H_FILE,
+                              (long long)NOT_A_FILE, -1LL,
+                              (long long)NOT_A_FILE);
+   vWrapR = _mm256_set_epi64x((long long)NOT_A_FILE,
+                              (long long)NOT_H_FILE, -1LL,
+                              (long long)NOT_H_FILE);
+   vMove = _mm256_set1_epi64x((long long)((uint64_t)1 << iSquare));
+   vOwn = _mm256_set1_epi64x((long long)uOwn);
+   vOpp = _mm256_set1_epi64x((long long)uOpp);
+   vOppL = _mm256_and_si256(vOpp, vWrapL);
+   vOppR = _mm256_and_si256(vOpp, vWrapR);
+
+   vRunL = _mm256_and_si256(_mm256_sllv_epi64(vMove, vShift), vOppL);
+   vRunR = _mm256_and_si256(_mm256_srlv_epi64(vMove, vShift), vOppR);
+   for (i = 1; i < MAX_RUN; i++) {
+      vRunL = _mm256_or_si256(vRunL, _mm256_and_si256(
+         _mm256_sllv_epi64(vRunL, vShift), vOppL));
+      vRunR = _mm256_or_si256(vRunR, _mm256_and_si256(
+         _mm256_srlv_epi64(vRunR, vShift), vOppR));
+   }
+
+   /* Keep the runs that a tile of the current player closes off. */
+   vZero = _mm256_setzero_si256();
+   vEndL = _mm256_and_si256(_mm256_and_si256(
+      _mm256_sllv_epi64(vRunL, vShift), vOwn), vWrapL);
+   vEndR = _mm256_and_si256(_mm256_and_si256(
+      _mm256_srlv_epi64(vRunR, vShift), vOwn), vWrapR);
+   vFlips = _mm256_or_si256(
+      _mm256_andnot_si256(_mm256_cmpeq_epi64(vEndL, vZero), vRunL),
+      _mm256_andnot_si256(_mm256_cmpeq_epi64(vEndR, vZero), vRunR));
+
+   /* Merge the four lanes. */
+   vHalf = _mm_or_si128(_mm256_castsi256_si128(vFlips),
+                        _mm256_extracti128_si256(vFlips, 1));
+   vHalf = _mm_or_si128(vHalf, _mm_unpackhi_epi64(vHalf, vHalf));
+   return (uint64_t)_mm_cvtsi128_si64(vHalf);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* The flip kernel in use and its name. */
+static uint64_t (*pfFlips)(uint64_t, uint64_t, int) = Bitboard_flipsScalar;
+static const char *pcFlipKernel = "scalar";
+
+#ifdef BITBOARD_X86
+/*--------------------------------------------------------------------*/
+/* Picks the fastest flip kernel the processor supports when the
+   program starts. */
+
+__attribute__((constructor))
+static void Bitboard_pickFlipKernel(void) {
+   if (Bitboard_setFlipKernel("avx2") == 0)
+      (void)Bitboard_setFlipKernel("sse2");
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+int Bitboard_setFlipKernel(const char *pcName) {
+
+   assert(pcName != NULL);
+
+   if (strcmp(pcName, "scalar") == 0) {
+      pfFlips = Bitboard_flipsScalar;
+      pcFlipKernel = "scalar";
+      return 1;
+   }
+#ifdef BITBOARD_X86
+   __builtin_cpu_init();
+   if (strcmp(pcName, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+      pfFlips = Bitboard_flipsSse2;
+      pcFlipKernel = "sse2";
+      return 1;
+   }
+   if (strcmp(pcName, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+      pfFlips = Bitboard_flipsAvx2;
+      pcFlipKernel = "avx2";
+      return 1;
+   }
+#endif
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+const char *Bitboard_getFlipKernel(void) {
+   return pcFlipKernel;
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Bitboard_flips(uint64_t uOwn, uint64_t uOpp, int iSquare) {
+   return (*pfFlips)(uOwn, uOpp, iSquare);
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,103 @@
+/*--------------------------------------------------------------------*/
+/* bitboard.h                                                         */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef BITBOARD_INCLUDED
+#define BITBOARD_INCLUDED
+
+#include <stdint.h>
+
+/* A bitboard is a 64-bit mask with one bit for every tile of the
+   othello board. Bit (row * 8 + column) stands for the tile at the
+   given row and column, so row 0 is the low byte of the mask. */
+
+/* Returns the bitboard with only the tile at row and column set. */
+#define Bitboard_square(row, column) \
+   ((uint64_t)1 << ((unsigned)(row) * 8u + (unsigned)(column)))
+
+/* Returns the tiles of uOpp that would be flipped if the player that
+   owns uOwn played on iSquare (row * 8 + column). Returns 0 if the
+   move flips nothing, i.e. if it is not a legal move. Playing the move
+   and flipping these tiles back afterwards undoes it. */
+uint64_t Bitboard_flips(uint64_t uOwn, uint64_t uOpp, int iSquare);
+
+/* Makes Bitboard_flips() use the flip kernel named pcName, one of
+   "scalar", "sse2" or "avx2". The fastest kernel the processor
+   supports is used by default. Returns 1 if successful and 0 if the
+   kernel is not available. */
+int Bitboard_setFlipKernel(const char *pcName);
+
+/* Returns the name of the flip kernel in use. */
+const char *Bitboard_getFlipKernel(void);
+
+/* Returns the bitboard of every empty tile on which the player that
+   owns uOwn can legally move against uOpp. */
+uint64_t Bitboard_legalMoves(uint64_t uOwn, uint64_t uOpp);
+
+/* Returns the index (row * 8 + column) of the lowest tile set in u,
+   which must not be 0. */
+static inline int Bitboard_first(uint64_t u) {
+#ifdef __GNUC__
+   return __builtin_ctzll(u);
+#else
+   int i = 0;
+
+   while ((u & 1) == 0) {
+      u >>= 1;
+      i++;
+   }
+   return i;
+#endif
+}
+
+/* Returns the number of tiles set in u. */
+static inline int Bitboard_count(uint64_t u) {
+#ifdef __GNUC__
+   return __builtin_popcountll(u);
+#else
+   u = u - ((u >> 1) & 0x5555555555555555ULL);
+   u = (u & 0x3333333333333333ULL) + ((u >> 2) & 0x3333333333333333ULL);
+   u = (u + (u >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+   return (int)((u * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Returns u mirrored left to right, so that column c becomes column
+   7 - c. */
+static inline uint64_t Bitboard_mirror(uint64_t u) {
+   u = ((u >> 1) & 0x5555555555555555ULL)
+      | ((u & 0x5555555555555555ULL) << 1);
+   u = ((u >> 2) & 0x3333333333333333ULL)
+      | ((u & 0x3333333333333333ULL) << 2);
+   return ((u >> 4) & 0x0F0F0F0F0F0F0F0FULL)
+      | ((u & 0x0F0F0F0F0F0F0F0FULL) << 4);
+}
+
+/* Returns u flipped upside down, so that row r becomes row 7 - r. */
+static inline uint64_t Bitboard_flip(uint64_t u) {
+#ifdef __GNUC__
+   return __builtin_bswap64(u);
+#else
+   u = ((u >> 8) & 0x00FF00FF00FF00FFULL)
+      | ((u & 0x00FF00FF00FF00FFULL) << 8);
+   u = ((u >> 16) & 0x0000FFFF0000FFFFULL)
+      | ((u & 0x0000FFFF0000FFFFULL) << 16);
+   return (u >> 32) | (u << 32);
+#endif
+}
+
+/* Returns u flipped about the diagonal from row 0, column 0 to row 7,
+   column 7, so that its rows become its columns. */
+static inline uint64_t Bitboard_transpose(uint64_t u) {
+
+   uint64_t uSwap;
+
+   uSwap = 0x0F0F0F0F00000000ULL & (u ^ (u << 28));
+   u ^= uSwap ^ (uSwap >> 28);
+   uSwap = 0x3333000033330000ULL & (u ^ (u << 14));
+   u ^= uSwap ^ (uSwap >> 14);
+   uSwap = 0x5500550055005500ULL & (u ^ (u << 7));
+   return u ^ uSwap ^ (uSwap >> 7);
+}
+
+#endif
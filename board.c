@@ -3,7 +3,9 @@
 /* Author: Ally Dalman                                                */
 /*--------------------------------------------------------------------*/
 
+#include <stddef.h>
 #include "board.h"
+#include "bitboard.h"
 
 /* Size of the array. */
 enum {SIZE = 8};
@@ -20,15 +22,132 @@ enum {INITIAL_TILE1 = 3};
 /* The location of the initial tiles.*/
 enum {INITIAL_TILE2 = 4};
 
+/* Maximum number of moves in a game, i.e. the number of tiles that
+   are empty at the start. */
+enum {MAX_MOVES = 60};
+
 /*--------------------------------------------------------------------*/
 
+/* The random keys of Zobrist hashing. The hash of a board is the
+   exclusive or of the key of every tile for the player that owns it,
+   indexed by player number - 1, and of SIDE_KEY if the second player
+   is the current player. */
+static const uint64_t auTileKey[2][SIZE * SIZE] = {
+   {
+      0x6870D580C15D330AULL, 0xA2521E75C639B32CULL,
+      0x6985BB37BA92DFC7ULL, 0x4B2A4F322C4135DFULL,
+      0xE8289E29546200A3ULL, 0x4F6A45218CE57786ULL,
+      0x9C586B229800EBF6ULL, 0xBDA6B697C0F02B83ULL,
+      0x5FBBAD3263FEFF7BULL, 0x5F9AD02DEC1F7124ULL,
+      0xE22747BA6BE18208ULL, 0xF443841CE2D1944BULL,
+      0x316998F2F179043EULL, 0x208911382D22A7B7ULL,
+      0xA8C3BBE30F27833FULL, 0x20A4CFA78C26AA2EULL,
+      0xE866D661520B1C64ULL, 0x66AEF6A67E4D5B67ULL,
+      0x30BAB5DF1455B2FEULL, 0x071288615380AB3AULL,
+      0xC390C139F923513CULL, 0x4A298C3ADFB8B60CULL,
+      0x4F3E68675C28555EULL, 0xCAE2F940635E3E19ULL,
+      0xAB30D717E1160134ULL, 0xE5F1259A1931924BULL,
+      0xE86D555719D047C8ULL, 0x470341CB969597EAULL,
+      0x711BF0D421262F62ULL, 0x5A449E5AED2BDED9ULL,
+      0xB39E4658E7A91765ULL, 0x3CA6DE6C8104D376ULL,
+      0x435D325C7C4A6E54ULL, 0x062F36941E7AEEC0ULL,
+      0x15A23201A3A35019ULL, 0x7E4DD2F1E4FA3F84ULL,
+      0x10F7F7C72B2755B7ULL, 0x261BD0F167CAB619ULL,
+      0x1DC54E7885C5AC1AULL, 0x0FED5298497C3676ULL,
+      0x70C7D0B69513F5D4ULL, 0xBC9DD37331324925ULL,
+      0x6BBE0401600CE76DULL, 0x18A4C637C82810B0ULL,
+      0x6A57505B01687352ULL, 0xD5813662E5BA0BFDULL,
+      0x80CA5A274255EDB3ULL, 0x3B0C317CFE12480AULL,
+      0x1935F7A9A0B61840ULL, 0xA426DF12C26964CDULL,
+      0x355C487046F42BC8ULL, 0x581649FEC676F6F2ULL,
+      0xDFB558313670EE88ULL, 0xAFC90F96F39F7FF2ULL,
+      0x6A97981FE7B19A69ULL, 0xCB2B3FD427E51932ULL,
+      0xCADB88C8FB89B2AFULL, 0x3D997049BD685AF2ULL,
+      0xDFD4B8EDEDFF5CF1ULL, 0xA819201D9718430FULL,
+      0xFE912A777775BDEBULL, 0x488135EA0C993F71ULL,
+      0x6962C6136003139DULL, 0x1612714358C1C465ULL
+   },
+   {
+      0xFB035F1F96E9EAC4ULL, 0x94FCF842B17E2BDEULL,
+      0x083C810A597056C9ULL, 0xC17752E6B4843E7DULL,
+      0xB7D398B61EF1B531ULL, 0x6BDAF738A875C1D3ULL,
+      0x57789AC2D293E84CULL, 0xF9BDB9673BA16F27ULL,
+      0xEE98EC8A20366908ULL, 0x1C00D176185C797DULL,
+      0xB551A29D0C3986ECULL, 0x5BCD6967A8864030ULL,
+      0x929F4D122DC6AADCULL, 0x58983037FD906B0CULL,
+      0x9258C14A520802CDULL, 0x88634AF60C5969FEULL,
+      0x2D9F19627918804AULL, 0xBF7454A573F765E5ULL,
+      0xAB769BE256B2A5ABULL, 0xD7E610ED0D8F1D90ULL,
+      0x36B9D125FA30DB71ULL, 0x510E3FBAE1855695ULL,
+      0x0E701ABC9EA9AEDFULL, 0xDC0C94ADFFB361E0ULL,
+      0x89F44B7A9B2FD604ULL, 0x4952A6C45F83C4C2ULL,
+      0x55150A73915C8CD1ULL, 0x8BEF0A4BC92785E3ULL,
+      0xD77EBFE6B734000CULL, 0x64092C6BD0E7CF65ULL,
+      0xB5A4C5E6F087EA58ULL, 0xD32AB72396C3DEC2ULL,
+      0x53EF7DAFC281BBF7ULL, 0x0A97A44F4D91A60FULL,
+      0x307031C4F21E9796ULL, 0xDA7E5A8C1F626376ULL,
+      0x0D434997C74E8266ULL, 0xFF16C49FAA9B434DULL,
+      0x18D59A07C7BD0EB1ULL, 0x38DFA3A18BA0DDBAULL,
+      0x0F7C707884A49048ULL, 0x5860F2D6D34342C9ULL,
+      0x45F762F131177AC0ULL, 0x46ACADEB0529C0E5ULL,
+      0x620B315D02E55983ULL, 0xD6248832AAE73105ULL,
+      0xFB41695BA1FBBE84ULL, 0xFF238E14B2594C7CULL,
+      0x46043E9DDCA0AC5DULL, 0xA6A7D070F01820BEULL,
+      0xE892E9FDEE12579BULL, 0xDE229BDB008FA67CULL,
+      0x606B2AEA23CAE3D5ULL, 0x9FB5281FC2887FE1ULL,
+      0xEDF9DED332AB3B60ULL, 0x4441B8E613F2AD77ULL,
+      0xB275B091820BD860ULL, 0x63FCBFDF3DAB4C45ULL,
+      0x0E796BEE299F4138ULL, 0xA6158407C341F5A2ULL,
+      0x72AAADE1B9FDAD28ULL, 0xCE28C227635090C0ULL,
+      0xE21D953F7C50EDE3ULL, 0xF802FE382A3F0060ULL
+   }
+};
+#define SIDE_KEY 0xBBD5E94CAFF00D0FULL
+
+/* A move on the board, kept so that it can be taken back. */
+struct Undo {
+   /* The tiles that the move flipped. */
+   uint64_t uFlips;
+
+   /* The hash of the board before the move. */
+   uint64_t uHash;
+
+   /* The tile that the move was made on, i.e. row * 8 + column. */
+   unsigned char square;
+
+   /* The player that made the move. */
+   unsigned char player;
+};
+
 struct Board {
+#ifdef BOARD_BITBOARD
+   /* The tiles of each player, indexed by player number - 1. */
+   uint64_t auTiles[2];
+#else
    /* The 8 by 8 array that represents the board. */
    int board[SIZE][SIZE];
+#endif
 
    /* The current player. */
    int player;
 
+   /* The Zobrist hash of the tiles and the current player, kept up to
+      date as moves are made. */
+   uint64_t hash;
+
+   /* The number of tiles of each player, indexed by player number - 1,
+      and the empty tiles as a bitmask, kept up to date as moves are
+      made and taken back. */
+   int aiCount[2];
+   uint64_t uEmpty;
+
+   /* The moves each player could make, indexed by player number - 1.
+      They are found when first asked for and kept until the tiles
+      change: auMoves[i] is only valid if bit i of movesKnown is set,
+      and making or taking back a move clears movesKnown. */
+   uint64_t auMoves[2];
+   int movesKnown;
+
    /* Variable that stores whether or not tracking is on.*/
    int track;
 
@@ -36,8 +155,23 @@ struct Board {
       on. */
    FILE *file;
 
+   /* The number of moves on the undo stack. */
+   int moves;
+
+   /* The moves made so far, oldest first, so that Board_unmakeMove can
+      take them back without having to allocate memory. */
+   struct Undo undo[MAX_MOVES];
+
+   /* Whether Board_init allocated the board, so that Board_free frees
+      it. */
+   int allocated;
 };
 
+/* A struct Board_Storage must be able to hold a struct Board; if not,
+   this array has a negative size and board.c does not compile. */
+typedef char Board_storageFits[(sizeof(struct Board)
+                                <= sizeof(struct Board_Storage)) ? 1 : -1];
+
 /*--------------------------------------------------------------------*/
 
 /* Returns the number of the other player, i.e. the player that is not
@@ -47,14 +181,15 @@ static int Board_getOtherPlayer(Board_T oBoard) {
    if (oBoard->player == 2) return 1;
    return 0;
 }
+#ifndef BOARD_BITBOARD
 /*--------------------------------------------------------------------*/
 /* Checks that the tile corresponding to a given row and column on the 
-   oBoard is a legal move. dy and dx correspond to the direction from 
-   the tile that is being checked. If the tile in that direction belongs
-   to the other player is and is eventually bordered by a tile of the 
-   current player, return 1 for success. Otherwise return 0. */
-static int Board_legalMove(Board_T oBoard, int row, int column, int dy
-                           , int dx) {
+   oBoard is a legal move for player. dy and dx correspond to the
+   direction from the tile that is being checked. If the tile in that
+   direction belongs to the other player is and is eventually bordered
+   by a tile of player, return 1 for success. Otherwise return 0. */
+static int Board_legalMove(Board_T oBoard, int player, int row,
+                           int column, int dy, int dx) {
 
    int rTemp;
    int cTemp;
@@ -65,12 +200,14 @@ static int Board_legalMove(Board_T oBoard, int row, int column, int dy
    /* Check that move is adjacent to a tile in use and there is a tile
       of the other player in between the move and a tile of the current
       player. */
-   while (oBoard->board[rTemp][cTemp] == Board_getOtherPlayer(oBoard)) {
+   while ((cTemp < SIZE) && (cTemp >= 0) && (rTemp < SIZE)
+          && (rTemp >= 0)
+          && (oBoard->board[rTemp][cTemp] == 3 - player)) {
       rTemp = rTemp + dy;
       cTemp = cTemp + dx;
       if ((cTemp < SIZE) && (cTemp >= 0) && (rTemp < SIZE)
           && (rTemp >= 0)) {
-         if (oBoard->board[rTemp][cTemp] == oBoard->player) return 1;
+         if (oBoard->board[rTemp][cTemp] == player) return 1;
       }
    }
    return 0;
@@ -79,9 +216,10 @@ static int Board_legalMove(Board_T oBoard, int row, int column, int dy
 /*--------------------------------------------------------------------*/
 /* Flips tiles on an oBoard that result from a certain move 
    corresponding to the given row and column. dy and dx correspond to
-   the current direction that is being checked. */
+   the current direction that is being checked. Adds the flipped tiles
+   to *puFlips. */
 static void Board_flipTiles(Board_T oBoard, int row, int column,
-                            int dy, int dx) {
+                            int dy, int dx, uint64_t *puFlips) {
 
    int rTemp, cTemp;
 
@@ -90,7 +228,9 @@ static void Board_flipTiles(Board_T oBoard, int row, int column,
 
    /* Increment move as long as tile belongs to the other player    
       until a tile belonging to the current player is reached. */
-   while (oBoard->board[rTemp][cTemp] == Board_getOtherPlayer(oBoard))
+   while ((cTemp < SIZE) && (cTemp >= 0) && (rTemp < SIZE)
+          && (rTemp >= 0)
+          && (oBoard->board[rTemp][cTemp] == Board_getOtherPlayer(oBoard)))
    {
       rTemp = rTemp + dy;
       cTemp = cTemp + dx;
@@ -101,6 +241,8 @@ static void Board_flipTiles(Board_T oBoard, int row, int column,
             for (;;) {
                /* Go back to original tile, flipping all tiles
                   in between. */
+               if (oBoard->board[rTemp][cTemp] != oBoard->player)
+                  *puFlips |= Bitboard_square(rTemp, cTemp);
                oBoard->board[rTemp][cTemp] = oBoard->player;
                rTemp = rTemp - dy;
                cTemp = cTemp - dx;
@@ -112,60 +254,169 @@ static void Board_flipTiles(Board_T oBoard, int row, int column,
 }
 
 /*--------------------------------------------------------------------*/
-/* Checks that the next player can make a valid move on oBoard. Returns
-   1 if a valid move exists and 0 if not. */
+/* Checks that the tile corresponding to the given row and column on
+   oBoard is a valid move for player by calling Board_legalMove() in
+   all 8 directions around the tile. Returns 1 if it is and 0 if
+   not. */
+static int Board_tileIsLegal(Board_T oBoard, int player, int row,
+                             int column) {
 
-static int Board_nextMove(Board_T oBoard) {
+   int i;
+   int rChange;
+   int cChange;
 
-   int row, column;
+   /* Make sure the tile is available. */
+   if (oBoard->board[row][column] == 0) {
 
-   for (row = 0; row < SIZE; row++) {
-      for (column = 0; column < SIZE; column++) {
-         if (Board_moveIsValid(oBoard, row, column) == 1) return 1;
-      }
+      /* North. */
+      rChange = -1;
+      cChange = 0;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
+
+      /* Northeast. */
+      rChange = -1;
+      cChange = 1;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
+
+      /* East. */
+      rChange = 0;
+      cChange = 1;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
+
+      /* Southeast. */
+      rChange = 1;
+      cChange = 1;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
+
+      /* South. */
+      rChange = 1;
+      cChange = 0;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
+      
+      /* Southwest. */
+      rChange = 1;
+      cChange = -1;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
+
+      /* West. */
+      rChange = 0;
+      cChange = -1;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
+
+      /* Northwest. */
+      rChange = -1;
+      cChange = -1;
+      i = Board_legalMove(oBoard, player, row, column, rChange,
+                          cChange);
+      if (i == 1) return i;
    }
    return 0;
 }
+#endif
 
 /*--------------------------------------------------------------------*/
-/* Counts how many tiles on the oBoard belong to the given player. 
-   Returns the number of tiles.*/
+/* Checks that the next player can make a valid move on oBoard. Returns
+   1 if a valid move exists and 0 if not. */
 
-static int Board_countTiles(Board_T oBoard, int player) {
+static int Board_nextMove(Board_T oBoard) {
+   return Board_legalMoves(oBoard) != 0;
+}
+/*--------------------------------------------------------------------*/
+Board_T Board_init(int tracking, FILE *psFile) {
 
-   int row, column, count;
-   count = 0;
+   Board_T oBoard;
 
-   /* Count the number of tiles belonging to given player. */
-   for (row = 0; row < SIZE; row++) {
-      for (column = 0; column < SIZE; column++) {
-         if (oBoard->board[row][column] == player) count++;
-      }
-   }
-   return count;
+   /* Initialize the oBoard.*/
+   oBoard = (Board_T)malloc(sizeof(struct Board));
+   assert(oBoard != NULL);
+   (void)Board_initIn((struct Board_Storage *)(void *)oBoard, tracking,
+                      psFile);
+   oBoard->allocated = 1;
+   return oBoard;
 }
+
 /*--------------------------------------------------------------------*/
-Board_T Board_init(int tracking, FILE *psFile) {
+Board_T Board_initIn(struct Board_Storage *psStorage, int tracking,
+                     FILE *psFile) {
 
    Board_T oBoard;
 
+   assert(psStorage != NULL);
    if (tracking == 1) assert(psFile != NULL);
 
-   /* Initialize the oBoard.*/
-   oBoard = (Board_T)calloc(sizeof(struct Board), 1);
-   assert(oBoard != NULL);
+   /* The undo stack is filled as moves are made, so only what comes
+      before it needs clearing. */
+   oBoard = (Board_T)(void *)psStorage;
+   memset(oBoard, 0, offsetof(struct Board, undo));
+   oBoard->allocated = 0;
    oBoard->player = 1;
    oBoard->track = tracking;
    oBoard->file = psFile;
 
    /* Set up the center four tiles. */
+#ifdef BOARD_BITBOARD
+   oBoard->auTiles[1] = Bitboard_square(INITIAL_TILE1, INITIAL_TILE1)
+      | Bitboard_square(INITIAL_TILE2, INITIAL_TILE2);
+   oBoard->auTiles[0] = Bitboard_square(INITIAL_TILE1, INITIAL_TILE2)
+      | Bitboard_square(INITIAL_TILE2, INITIAL_TILE1);
+#else
    oBoard->board[INITIAL_TILE1][INITIAL_TILE1] = 2;
    oBoard->board[INITIAL_TILE2][INITIAL_TILE2] = 2;
    oBoard->board[INITIAL_TILE1][INITIAL_TILE2] = 1;
    oBoard->board[INITIAL_TILE2][INITIAL_TILE1] = 1;
+#endif
+   oBoard->hash = auTileKey[1][INITIAL_TILE1 * SIZE + INITIAL_TILE1]
+      ^ auTileKey[1][INITIAL_TILE2 * SIZE + INITIAL_TILE2]
+      ^ auTileKey[0][INITIAL_TILE1 * SIZE + INITIAL_TILE2]
+      ^ auTileKey[0][INITIAL_TILE2 * SIZE + INITIAL_TILE1];
+   oBoard->aiCount[0] = 2;
+   oBoard->aiCount[1] = 2;
+   oBoard->uEmpty = ~(Bitboard_square(INITIAL_TILE1, INITIAL_TILE1)
+                      | Bitboard_square(INITIAL_TILE1, INITIAL_TILE2)
+                      | Bitboard_square(INITIAL_TILE2, INITIAL_TILE1)
+                      | Bitboard_square(INITIAL_TILE2, INITIAL_TILE2));
 
    return oBoard;
 }
+/*--------------------------------------------------------------------*/
+Board_T Board_copyIn(struct Board_Storage *psStorage, Board_T oBoard) {
+
+   Board_T oCopy;
+
+   assert(psStorage != NULL);
+   assert(oBoard != NULL);
+
+   /* Only the moves on the undo stack are copied, not all of it. */
+   oCopy = (Board_T)(void *)psStorage;
+   memcpy(oCopy, oBoard, offsetof(struct Board, undo));
+   memcpy(oCopy->undo, oBoard->undo,
+          (size_t)oBoard->moves * sizeof(struct Undo));
+   oCopy->allocated = 0;
+   oCopy->track = 0;
+   oCopy->file = NULL;
+   return oCopy;
+}
+
+/*--------------------------------------------------------------------*/
+void Board_free(Board_T oBoard) {
+   assert(oBoard != NULL);
+   if (oBoard->allocated == 1) free(oBoard);
+}
+
 /*--------------------------------------------------------------------*/
 int Board_draw(Board_T oBoard)
 {
@@ -186,11 +437,13 @@ int Board_draw(Board_T oBoard)
    
    /* Set the next player to be the other player. */
    oBoard->player = Board_getOtherPlayer(oBoard);
+   oBoard->hash ^= SIDE_KEY;
 
    /* If the other player doesn't have any valid moves, set the player 
     back to the player that just went.*/
    if (Board_nextMove(oBoard) == 0) {
       oBoard->player = Board_getOtherPlayer(oBoard);
+      oBoard->hash ^= SIDE_KEY;
       /* If neither player has a valid move, return 0. */
       if (Board_nextMove(oBoard) == 0) return 0;
       return oBoard->player;
@@ -203,164 +456,390 @@ int Board_draw(Board_T oBoard)
 /* Returns the character symbol for any tile on oBoard where the row 
    and column are given. */
 char Board_getSymbol(Board_T oBoard, int row, int column) {
+#ifdef BOARD_BITBOARD
+   uint64_t uTile = Bitboard_square(row, column);
+
+   if ((oBoard->auTiles[0] & uTile) != 0) return 'x';
+   if ((oBoard->auTiles[1] & uTile) != 0) return 'o';
+   return '.';
+#else
    if (oBoard->board[row][column] == 0)  return '.';
    else if (oBoard->board[row][column] == 1)  return 'x';
    else if (oBoard->board[row][column] == 2)  return 'o';
    return '\0';
+#endif
 }
+
 /*--------------------------------------------------------------------*/
-int Board_moveIsValid(Board_T oBoard, int row, int column) {
+void Board_pack(Board_T oBoard, struct Board_Packed *psPacked) {
 
-   int i;
-   int rChange;
-   int cChange;
+#ifdef BOARD_BITBOARD
+   assert(oBoard != NULL);
+   assert(psPacked != NULL);
 
-   /* Make sure the move is within bounds and available. */
-   if ((row < SIZE) && (row >= 0) && (column < SIZE)
-       && (column >= 0)) {
-      
-      if (oBoard->board[row][column] == 0) {
-
-         /* North. */
-         rChange = -1;
-         cChange = 0;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
-
-         /* Northeast. */
-         rChange = -1;
-         cChange = 1;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
-
-         /* East. */
-         rChange = 0;
-         cChange = 1;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
-
-         /* Southeast. */
-         rChange = 1;
-         cChange = 1;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
-
-         /* South. */
-         rChange = 1;
-         cChange = 0;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
-         
-         /* Southwest. */
-         rChange = 1;
-         cChange = -1;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
-
-         /* West. */
-         rChange = 0;
-         cChange = -1;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
-
-         /* Northwest. */
-         rChange = -1;
-         cChange = -1;
-         i = Board_legalMove(oBoard, row, column, rChange, cChange);
-         if (i == 1) return i;
+   psPacked->uOwn = oBoard->auTiles[oBoard->player - 1];
+   psPacked->uOpp = oBoard->auTiles[2 - oBoard->player];
+#else
+   int row, column;
+
+   assert(oBoard != NULL);
+   assert(psPacked != NULL);
+
+   psPacked->uOwn = psPacked->uOpp = 0;
+   for (row = 0; row < SIZE; row++) {
+      for (column = 0; column < SIZE; column++) {
+         if (oBoard->board[row][column] == oBoard->player)
+            psPacked->uOwn |= Bitboard_square(row, column);
+         else if (oBoard->board[row][column] != 0)
+            psPacked->uOpp |= Bitboard_square(row, column);
       }
    }
-   return 0;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the bitboard u turned by symmetry iSymmetry. */
+
+static uint64_t Board_turn(uint64_t u, int iSymmetry) {
+   if ((iSymmetry & 4) != 0) u = Bitboard_transpose(u);
+   if ((iSymmetry & 1) != 0) u = Bitboard_mirror(u);
+   if ((iSymmetry & 2) != 0) u = Bitboard_flip(u);
+   return u;
+}
+
+/*--------------------------------------------------------------------*/
+void Board_transform(const struct Board_Packed *psPacked, int iSymmetry,
+                     struct Board_Packed *psTurned) {
+
+   assert(psPacked != NULL);
+   assert(psTurned != NULL);
+   assert(iSymmetry >= 0 && iSymmetry < BOARD_SYMMETRIES);
+
+   psTurned->uOwn = Board_turn(psPacked->uOwn, iSymmetry);
+   psTurned->uOpp = Board_turn(psPacked->uOpp, iSymmetry);
+}
+
+/*--------------------------------------------------------------------*/
+int Board_transformSquare(int iSquare, int iSymmetry) {
+
+   int row, column, iSwap;
+
+   assert(iSquare >= 0 && iSquare < SIZE * SIZE);
+   assert(iSymmetry >= 0 && iSymmetry < BOARD_SYMMETRIES);
+
+   row = iSquare / SIZE;
+   column = iSquare % SIZE;
+   if ((iSymmetry & 4) != 0) {
+      iSwap = row;
+      row = column;
+      column = iSwap;
+   }
+   if ((iSymmetry & 1) != 0) column = SIZE - 1 - column;
+   if ((iSymmetry & 2) != 0) row = SIZE - 1 - row;
+   return row * SIZE + column;
+}
+
+/*--------------------------------------------------------------------*/
+int Board_inverseSymmetry(int iSymmetry) {
+
+   assert(iSymmetry >= 0 && iSymmetry < BOARD_SYMMETRIES);
+
+   /* Mirroring or flipping before a swap of rows and columns is
+      flipping or mirroring after it, so the inverse of a symmetry with
+      a swap trades the two. The others undo themselves. */
+   if ((iSymmetry & 4) == 0) return iSymmetry;
+   return 4 | ((iSymmetry & 1) << 1) | ((iSymmetry & 2) >> 1);
+}
+
+/*--------------------------------------------------------------------*/
+int Board_canonical(const struct Board_Packed *psPacked,
+                    struct Board_Packed *psCanonical) {
+
+   uint64_t auOwn[BOARD_SYMMETRIES], auOpp[BOARD_SYMMETRIES];
+   int i, iBest;
+
+   assert(psPacked != NULL);
+   assert(psCanonical != NULL);
+
+   /* Each transform is done once: the copies with a bit of the
+      symmetry set are made from the one without it. */
+   auOwn[0] = psPacked->uOwn;
+   auOpp[0] = psPacked->uOpp;
+   auOwn[4] = Bitboard_transpose(auOwn[0]);
+   auOpp[4] = Bitboard_transpose(auOpp[0]);
+   for (i = 0; i < BOARD_SYMMETRIES; i += 4) {
+      auOwn[i + 1] = Bitboard_mirror(auOwn[i]);
+      auOpp[i + 1] = Bitboard_mirror(auOpp[i]);
+      auOwn[i + 2] = Bitboard_flip(auOwn[i]);
+      auOpp[i + 2] = Bitboard_flip(auOpp[i]);
+      auOwn[i + 3] = Bitboard_flip(auOwn[i + 1]);
+      auOpp[i + 3] = Bitboard_flip(auOpp[i + 1]);
+   }
+
+   iBest = 0;
+   for (i = 1; i < BOARD_SYMMETRIES; i++) {
+      if (auOwn[i] < auOwn[iBest]
+          || (auOwn[i] == auOwn[iBest] && auOpp[i] < auOpp[iBest]))
+         iBest = i;
+   }
+   psCanonical->uOwn = auOwn[iBest];
+   psCanonical->uOpp = auOpp[iBest];
+   return iBest;
+}
+/*--------------------------------------------------------------------*/
+uint64_t Board_legalMoves(Board_T oBoard) {
+   return Board_getMoves(oBoard, oBoard->player);
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Board_getMoves(Board_T oBoard, int player) {
+
+#ifdef BOARD_BITBOARD
+   assert(player == 1 || player == 2);
+   if ((oBoard->movesKnown & player) == 0) {
+      oBoard->auMoves[player - 1] = Bitboard_legalMoves(
+         oBoard->auTiles[player - 1], oBoard->auTiles[2 - player]);
+      oBoard->movesKnown |= player;
+   }
+   return oBoard->auMoves[player - 1];
+#else
+   uint64_t auTiles[2];
+   int row, column;
+
+   assert(player == 1 || player == 2);
+   if ((oBoard->movesKnown & player) == 0) {
+      /* One pass over the array gives the tiles of both players, and
+         so the moves of both. */
+      auTiles[0] = auTiles[1] = 0;
+      for (row = 0; row < SIZE; row++) {
+         for (column = 0; column < SIZE; column++) {
+            if (oBoard->board[row][column] != 0)
+               auTiles[oBoard->board[row][column] - 1] |=
+                  Bitboard_square(row, column);
+         }
+      }
+      oBoard->auMoves[0] = Bitboard_legalMoves(auTiles[0], auTiles[1]);
+      oBoard->auMoves[1] = Bitboard_legalMoves(auTiles[1], auTiles[0]);
+      oBoard->movesKnown = 3;
+   }
+   return oBoard->auMoves[player - 1];
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+int Board_moveIsValid(Board_T oBoard, int row, int column) {
+
+   /* Make sure the move is within bounds. */
+   if ((row >= SIZE) || (row < 0) || (column >= SIZE) || (column < 0))
+      return 0;
+
+#ifndef BOARD_BITBOARD
+   /* Probing the one tile is quicker than finding every move. */
+   if ((oBoard->movesKnown & oBoard->player) == 0)
+      return Board_tileIsLegal(oBoard, oBoard->player, row, column);
+#endif
+   return (Board_legalMoves(oBoard) & Bitboard_square(row, column)) != 0;
 }
          
 /*--------------------------------------------------------------------*/
 int Board_makeMove(Board_T oBoard, int row, int column) {
 
+   int iSquare, iFlips;
+#ifdef BOARD_BITBOARD
+   uint64_t *puOwn, *puOpp;
+   uint64_t uFlips;
+
+   /* Place the tile and flip every tile it closes off in one go. */
+   puOwn = &oBoard->auTiles[oBoard->player - 1];
+   puOpp = &oBoard->auTiles[Board_getOtherPlayer(oBoard) - 1];
+   uFlips = Bitboard_flips(*puOwn, *puOpp, row * SIZE + column);
+   *puOwn |= uFlips | Bitboard_square(row, column);
+   *puOpp &= ~uFlips;
+#else
    int rChange;
    int cChange;
+   uint64_t uFlips;
 
+      uFlips = 0;
       oBoard->board[row][column] = oBoard->player;
 
       /* North. */
       rChange = -1;
       cChange = 0;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
 
       /* Northeast. */
       rChange = -1;
       cChange = 1;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
 
       /* East. */
       rChange = 0;
       cChange = 1;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
       
       /* Southeast. */
       rChange = 1;
       cChange = 1;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
       
       /* South. */
       rChange = 1;
       cChange = 0;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
       
       /* Southwest. */
       rChange = 1;
       cChange = -1;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
       
       /* West. */
       rChange = 0;
       cChange = -1;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
       
       /* Northwest. */
       rChange = -1;
       cChange = -1;
-      Board_flipTiles(oBoard, row, column, rChange, cChange);
+      Board_flipTiles(oBoard, row, column, rChange, cChange, &uFlips);
+#endif
+
+   /* Remember the move so that it can be taken back. */
+   assert(oBoard->moves < MAX_MOVES);
+   oBoard->undo[oBoard->moves].uFlips = uFlips;
+   oBoard->undo[oBoard->moves].uHash = oBoard->hash;
+   oBoard->undo[oBoard->moves].square =
+      (unsigned char)(row * SIZE + column);
+   oBoard->undo[oBoard->moves].player = (unsigned char)oBoard->player;
+   oBoard->moves++;
+
+   /* Update the counts and the empty tiles, and forget the moves. */
+   iFlips = Bitboard_count(uFlips);
+   oBoard->aiCount[oBoard->player - 1] += iFlips + 1;
+   oBoard->aiCount[2 - oBoard->player] -= iFlips;
+   oBoard->uEmpty &= ~Bitboard_square(row, column);
+   oBoard->movesKnown = 0;
+
+   /* Update the hash for the new tile and every flipped one. */
+   oBoard->hash ^= auTileKey[oBoard->player - 1][row * SIZE + column];
+   for (; uFlips != 0; uFlips &= uFlips - 1) {
+      iSquare = Bitboard_first(uFlips);
+      oBoard->hash ^= auTileKey[0][iSquare] ^ auTileKey[1][iSquare];
+   }
    
    return 1;
 }
 
+/*--------------------------------------------------------------------*/
+int Board_unmakeMove(Board_T oBoard) {
+
+   struct Undo *psUndo;
+   int iFlips;
+#ifndef BOARD_BITBOARD
+   int square;
+#endif
+
+   if (oBoard->moves == 0) return 0;
+   oBoard->moves--;
+   psUndo = &oBoard->undo[oBoard->moves];
+
+   /* Give the turn back to the player that made the move, then empty
+      its tile and flip the tiles it took back. */
+   oBoard->player = psUndo->player;
+   oBoard->hash = psUndo->uHash;
+   iFlips = Bitboard_count(psUndo->uFlips);
+   oBoard->aiCount[oBoard->player - 1] -= iFlips + 1;
+   oBoard->aiCount[2 - oBoard->player] += iFlips;
+   oBoard->uEmpty |= (uint64_t)1 << psUndo->square;
+   oBoard->movesKnown = 0;
+#ifdef BOARD_BITBOARD
+   oBoard->auTiles[oBoard->player - 1] ^=
+      psUndo->uFlips | ((uint64_t)1 << psUndo->square);
+   oBoard->auTiles[Board_getOtherPlayer(oBoard) - 1] ^= psUndo->uFlips;
+#else
+   oBoard->board[psUndo->square / SIZE][psUndo->square % SIZE] = 0;
+   for (square = 0; square < SIZE * SIZE; square++) {
+      if ((psUndo->uFlips & ((uint64_t)1 << square)) != 0)
+         oBoard->board[square / SIZE][square % SIZE] =
+            Board_getOtherPlayer(oBoard);
+   }
+#endif
+   return 1;
+}
+
 /*--------------------------------------------------------------------*/
 int Board_getPlayer(Board_T oBoard) {
    return oBoard->player;
 }
 
+/*--------------------------------------------------------------------*/
+uint64_t Board_getHash(Board_T oBoard) {
+   return oBoard->hash;
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Board_getTiles(Board_T oBoard, int player) {
+
+#ifdef BOARD_BITBOARD
+   assert(player == 1 || player == 2);
+   return oBoard->auTiles[player - 1];
+#else
+   int row, column;
+   uint64_t uTiles;
+
+   assert(player == 1 || player == 2);
+   uTiles = 0;
+   for (row = 0; row < SIZE; row++) {
+      for (column = 0; column < SIZE; column++) {
+         if (oBoard->board[row][column] == player)
+            uTiles |= Bitboard_square(row, column);
+      }
+   }
+   return uTiles;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+int Board_getScore(Board_T oBoard) {
+
+   assert(oBoard != NULL);
+
+   /* The score is equal to player 1's tiles minus player 2's. */
+   return oBoard->aiCount[0] - oBoard->aiCount[1];
+}
+
+/*--------------------------------------------------------------------*/
+int Board_getCount(Board_T oBoard, int player) {
+   assert(player == 1 || player == 2);
+   return oBoard->aiCount[player - 1];
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Board_getEmpty(Board_T oBoard) {
+   return oBoard->uEmpty;
+}
+
 /*--------------------------------------------------------------------*/
 int Board_endGame(Board_T oBoard, char *player1, char *player2) {
 
-   int count1;
-   int count2;
    int score;
 
    assert(player1 != NULL);
    assert(player2 != NULL);
-   if (oBoard->player == 1) {
-      count1 = Board_countTiles(oBoard, oBoard->player);
-      count2 = Board_countTiles(oBoard, Board_getOtherPlayer(oBoard));
-   }
-   else {
-      count2 = Board_countTiles(oBoard, oBoard->player);
-      count1 = Board_countTiles(oBoard, Board_getOtherPlayer(oBoard));
-   }
-   /* The score is equal to player 1's tiles minus player 2's. */
-   score = count1 - count2;
+   score = Board_getScore(oBoard);
 
    if (oBoard->track == 1) {
       fprintf(oBoard->file, "FIRST (%s) vs SECOND (%s)\n", player1, player2);
-      if (count1 > count2) {
+      if (score > 0) {
          fprintf(oBoard->file, "Winner FIRST %s\n", player1);
          fprintf(oBoard->file, "Score %d\n", score);
       }
-      else if (count2 > count1) {
+      else if (score < 0) {
          fprintf(oBoard->file, "Winner SECOND %s\n", player2);
          fprintf(oBoard->file, "Score %d\n", score);
          
       }
-      else if (count2 == count1) {
+      else {
          fprintf(oBoard->file, "Winner (draw)\n");
          fprintf(oBoard->file, "Score %d\n", score);
 
@@ -368,7 +847,7 @@ int Board_endGame(Board_T oBoard, char *player1, char *player2) {
       fclose(oBoard->file); /* Close file if tracking is on. */
    }
    
-   free(oBoard); /* Free memory. */
+   Board_free(oBoard); /* Free memory. */
    return score;
 }
 
@@ -390,18 +869,22 @@ int Board_endGameBad(Board_T oBoard, char *player1, char *player2,
          fprintf(oBoard->file, "Winner SECOND %s\n", player2);
          fprintf(oBoard->file, "Score %d\n", score);
          if (crash == 1) fprintf(oBoard->file, "Player crashed\n");
+         else if (crash == 2)
+            fprintf(oBoard->file, "Player timed out\n");
          else fprintf(oBoard->file, "Bad move\n");
       }
       if (oBoard->player == 2) {
          fprintf(oBoard->file, "Winner FIRST %s\n", player1);
          fprintf(oBoard->file, "Score %d\n", score);
          if (crash == 1) fprintf(oBoard->file, "Player crashed\n");
+         else if (crash == 2)
+            fprintf(oBoard->file, "Player timed out\n");
          else fprintf(oBoard->file, "Bad move\n");
       }
       fclose(oBoard->file); /* Close file if tracking is on. */
    }
    
-   free(oBoard); /*Free memory. */
+   Board_free(oBoard); /*Free memory. */
    return score;
 }
 /*--------------------------------------------------------------------*/
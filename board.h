@@ -14,17 +14,46 @@
 #include <string.h>
 #include <signal.h>
 #include <assert.h>
+#include <stdint.h>
 
-/* The Board object is a 2d integer array that represents the othello
-   board during a game. */
+/* The Board object represents the othello board during a game. By
+   default the tiles are kept in a 2d integer array. Building with
+   BOARD_BITBOARD defined keeps them in two 64-bit masks instead, one
+   per player. Both layouts behave the same through the functions
+   below. */
 
 typedef struct Board *Board_T;
 
+/* Memory for a board that the caller provides instead of the heap: on
+   the stack, in an array or in an arena of its own. Big enough for a
+   struct Board with either layout. */
+enum {BOARD_WORDS = 232};
+struct Board_Storage {
+   uint64_t auWords[BOARD_WORDS];
+};
+
 /* Creates and initializes a new oBoard object, given the tracking 
    number and the psFile to print to if tracking is on. Returns the 
    oBoard.*/
 Board_T Board_init(int tracking, FILE *psFile);
 
+/* Initializes a new oBoard object in psStorage, as Board_init does,
+   without allocating any memory. The board lasts as long as
+   psStorage, which it can be initialized in again to start another
+   game. Returns the oBoard. */
+Board_T Board_initIn(struct Board_Storage *psStorage, int tracking,
+                     FILE *psFile);
+
+/* Copies oBoard into psStorage, without allocating any memory, so
+   that moves can be made on the copy, and taken back as far as on
+   oBoard, while oBoard is left alone: by another thread, say. The copy
+   does not track. Returns the copy. */
+Board_T Board_copyIn(struct Board_Storage *psStorage, Board_T oBoard);
+
+/* Frees oBoard if Board_init created it, and does nothing if it is in
+   storage of the caller's. Does not close the tracking file. */
+void Board_free(Board_T oBoard);
+
 /* Draw the oBoard after the current move, give the corresponding 
    moveRow number and moveColumn character and the move count. Return 
    the number of the player that just went  or 0 if there are no valid 
@@ -36,24 +65,109 @@ int Board_draw(Board_T oBoard);
    the tile. Returns 1 if it is move and 0 if not.*/
 int Board_moveIsValid(Board_T oBoard, int row, int column);
    
+/* Returns a bitmask of every move the current player in oBoard can
+   make. Bit (row * 8 + column) is set if the move at that row and
+   column is valid. See also Board_getMoves. */
+uint64_t Board_legalMoves(Board_T oBoard);
+
 /* Make the move given by the row and column on oBoard. Return 1 if
    successful and 0 if not. */
 int Board_makeMove(Board_T oBoard, int row, int column);
 
+/* Takes back the last move made on oBoard by Board_makeMove, along
+   with the change of player made by Board_draw after it, so that the
+   player that made the move is the current player again. Returns 1 if
+   successful and 0 if there is no move to take back. */
+int Board_unmakeMove(Board_T oBoard);
+
 /* Returns the current player in oBoard. */
 int Board_getPlayer(Board_T oBoard);
 
-/* Ends the game on oBoard given the player1 and player2 names. Returns
-   the score.*/
+/* Returns the Zobrist hash of oBoard, which stands for its tiles and
+   its current player. Boards reached by different orders of moves
+   have the same hash. */
+uint64_t Board_getHash(Board_T oBoard);
+
+/* Returns a bitmask of the tiles that belong to the given player on
+   oBoard. Bit (row * 8 + column) is set if the tile at that row and
+   column is the player's. */
+uint64_t Board_getTiles(Board_T oBoard, int player);
+
+/* Returns the number of tiles that belong to the given player on
+   oBoard. The counts are kept as moves are made, so this takes no
+   scan of the board. */
+int Board_getCount(Board_T oBoard, int player);
+
+/* Returns a bitmask of the empty tiles of oBoard. Bit (row * 8 +
+   column) is set if the tile at that row and column is empty. */
+uint64_t Board_getEmpty(Board_T oBoard);
+
+/* Returns a bitmask of every move the given player could make on
+   oBoard, whether or not it is the current player, as
+   Board_legalMoves does. The moves of each player are found at most
+   once between two moves made or taken back, so asking again, as
+   Board_draw does to find passes, costs nothing. */
+uint64_t Board_getMoves(Board_T oBoard, int player);
+
+/* Returns the score of oBoard: the tiles of player 1 less those of
+   player 2. oBoard is left as it was. */
+int Board_getScore(Board_T oBoard);
+
+/* Ends the game on oBoard given the player1 and player2 names: writes
+   the result to the tracking file and closes it if tracking is on,
+   then frees oBoard with Board_free. Returns the score.*/
 int Board_endGame(Board_T oBoard, char *player1, char *player2);
 
 /* Ends the game badly (i.e. an invalid move is played) on oBoard given 
    the player1 and player2 names and int crash, which is 1 if one of the
-   player crashes. Returns the score. */
+   player crashes and 2 if it runs out of time. Writes and closes the
+   tracking file and frees oBoard as Board_endGame does. Returns the
+   score. */
 int Board_endGameBad(Board_T oBoard, char *player1, char *player2, int crash);
 
 /* Returns the character symbol for any tile on oBoard where the row 
    and column are given. */
 char Board_getSymbol(Board_T oBoard, int row, int column);
 
+/* A board packed into two bitboards (see bitboard.h), as the current
+   player sees it. */
+struct Board_Packed {
+   /* The tiles of the current player. */
+   uint64_t uOwn;
+
+   /* The tiles of the other player. */
+   uint64_t uOpp;
+};
+
+/* Number of symmetries of the board: the ways it can be turned or
+   flipped onto itself. Symmetry i first swaps rows and columns if bit
+   2 of i is set, then mirrors the board left to right if bit 0 is set
+   and turns it upside down if bit 1 is set. Symmetry 0 leaves the
+   board as it is. */
+enum {BOARD_SYMMETRIES = 8};
+
+/* Stores the tiles of the current player of oBoard and of the other
+   player in *psPacked. */
+void Board_pack(Board_T oBoard, struct Board_Packed *psPacked);
+
+/* Stores *psPacked turned by symmetry iSymmetry in *psTurned, which
+   may be psPacked. */
+void Board_transform(const struct Board_Packed *psPacked, int iSymmetry,
+                     struct Board_Packed *psTurned);
+
+/* Returns the tile (row * 8 + column) that iSquare is turned into by
+   symmetry iSymmetry. */
+int Board_transformSquare(int iSquare, int iSymmetry);
+
+/* Returns the symmetry that undoes symmetry iSymmetry. */
+int Board_inverseSymmetry(int iSymmetry);
+
+/* Stores in *psCanonical the canonical form of *psPacked, which may be
+   psPacked: the smallest of its turned copies, comparing the current
+   player's tiles first. All the copies have the same canonical form.
+   Returns the symmetry that turns *psPacked into it, the lowest one
+   if there are several. */
+int Board_canonical(const struct Board_Packed *psPacked,
+                    struct Board_Packed *psCanonical);
+
 #endif
@@ -0,0 +1,235 @@
+/*--------------------------------------------------------------------*/
+/* book.c                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for O_CLOEXEC */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "book.h"
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* The version of the book format. */
+enum {VERSION = 1};
+
+/* The first bytes of every book file. */
+static const unsigned char aucMagic[4] = {'O', 'T', 'H', 'B'};
+
+/*--------------------------------------------------------------------*/
+
+struct Book {
+   /* The mapped file, and its length. */
+   const unsigned char *pucData;
+   size_t ulSize;
+
+   /* The entries, and how many there are. */
+   const struct Book_Entry *psEntries;
+   long lCount;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns u with its bits mixed up, so that every bit of u changes
+   about half of the bits of the result (the finalizer of
+   MurmurHash3). */
+
+static uint64_t mix(uint64_t u) {
+   u ^= u >> 33;
+   u *= 0xFF51AFD7ED558CCDULL;
+   u ^= u >> 33;
+   u *= 0xC4CEB9FE1A85EC53ULL;
+   return u ^ (u >> 33);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the key of the canonical form *psCanonical of a position
+   (see Board_canonical). */
+
+static uint64_t makeKey(const struct Board_Packed *psCanonical) {
+   return mix(psCanonical->uOwn ^ mix(psCanonical->uOpp));
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Book_key(const struct Board_Packed *psPacked, int iSquare,
+                  int *piSquare) {
+
+   struct Board_Packed sCanonical, sTurned;
+   int iSymmetry, iTurned, i, iCopy;
+
+   assert(psPacked != NULL);
+   assert(iSquare >= -1 && iSquare < SIZE * SIZE);
+   assert(iSquare == -1 || piSquare != NULL);
+
+   iSymmetry = Board_canonical(psPacked, &sCanonical);
+   if (iSquare != -1) {
+      /* A position that is its own copy under some symmetries turns a
+         move into as many moves, which all lead to copies of the same
+         position. The smallest one stands for them all. */
+      iTurned = Board_transformSquare(iSquare, iSymmetry);
+      *piSquare = iTurned;
+      for (i = 1; i < BOARD_SYMMETRIES; i++) {
+         Board_transform(&sCanonical, i, &sTurned);
+         if (sTurned.uOwn != sCanonical.uOwn
+             || sTurned.uOpp != sCanonical.uOpp)
+            continue;
+         iCopy = Board_transformSquare(iTurned, i);
+         if (iCopy < *piSquare) *piSquare = iCopy;
+      }
+   }
+   return makeKey(&sCanonical);
+}
+
+/*--------------------------------------------------------------------*/
+/* Compares the keys of the struct Book_Entry pvFirst and pvSecond.
+   Returns a negative number, 0 or a positive number if the first is
+   smaller, the same or larger. */
+
+static int compareEntries(const void *pvFirst, const void *pvSecond) {
+
+   uint64_t uFirst, uSecond;
+
+   uFirst = ((const struct Book_Entry *)pvFirst)->uKey;
+   uSecond = ((const struct Book_Entry *)pvSecond)->uKey;
+   return (uFirst > uSecond) - (uFirst < uSecond);
+}
+
+/*--------------------------------------------------------------------*/
+int Book_write(const char *pcFile, struct Book_Entry *psEntries,
+               long lCount) {
+
+   unsigned char aucHeader[BOOK_HEADER];
+   uint64_t uCount;
+   FILE *psFile;
+   int iOk;
+
+   assert(pcFile != NULL);
+   assert(psEntries != NULL || lCount == 0);
+   assert(lCount >= 0);
+
+   qsort(psEntries, (size_t)lCount, sizeof(struct Book_Entry),
+         compareEntries);
+
+   memset(aucHeader, 0, sizeof(aucHeader));
+   memcpy(aucHeader, aucMagic, sizeof(aucMagic));
+   aucHeader[4] = VERSION;
+   uCount = (uint64_t)lCount;
+   memcpy(aucHeader + 8, &uCount, sizeof(uCount));
+
+   psFile = fopen(pcFile, "wb");
+   if (psFile == NULL) return 0;
+   iOk = (fwrite(aucHeader, 1, sizeof(aucHeader), psFile)
+          == sizeof(aucHeader)
+          && fwrite(psEntries, sizeof(struct Book_Entry), (size_t)lCount,
+                    psFile) == (size_t)lCount);
+   if (fclose(psFile) != 0) iOk = 0;
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+Book_T Book_open(const char *pcFile) {
+
+   Book_T oBook;
+   struct stat sStat;
+   uint64_t uCount;
+   void *pvData;
+   int iFd;
+
+   assert(pcFile != NULL);
+
+   iFd = open(pcFile, O_RDONLY | O_CLOEXEC);
+   if (iFd == -1) return NULL;
+   if (fstat(iFd, &sStat) == -1 || sStat.st_size < BOOK_HEADER) {
+      close(iFd);
+      return NULL;
+   }
+   pvData = mmap(NULL, (size_t)sStat.st_size, PROT_READ, MAP_SHARED, iFd,
+                 0);
+   close(iFd);
+   if (pvData == MAP_FAILED) return NULL;
+
+   oBook = (Book_T)calloc(1, sizeof(struct Book));
+   if (oBook == NULL) {
+      munmap(pvData, (size_t)sStat.st_size);
+      return NULL;
+   }
+   oBook->pucData = pvData;
+   oBook->ulSize = (size_t)sStat.st_size;
+
+   /* The file must hold exactly the entries that its header counts. */
+   memcpy(&uCount, oBook->pucData + 8, sizeof(uCount));
+   if (memcmp(oBook->pucData, aucMagic, sizeof(aucMagic)) != 0
+       || oBook->pucData[4] != VERSION
+       || (oBook->ulSize - BOOK_HEADER) % sizeof(struct Book_Entry) != 0
+       || (oBook->ulSize - BOOK_HEADER) / sizeof(struct Book_Entry)
+          != uCount) {
+      Book_close(oBook);
+      return NULL;
+   }
+   oBook->psEntries =
+      (const struct Book_Entry *)(oBook->pucData + BOOK_HEADER);
+   oBook->lCount = (long)uCount;
+   return oBook;
+}
+
+/*--------------------------------------------------------------------*/
+void Book_close(Book_T oBook) {
+
+   assert(oBook != NULL);
+
+   munmap((void *)oBook->pucData, oBook->ulSize);
+   free(oBook);
+}
+
+/*--------------------------------------------------------------------*/
+long Book_getCount(Book_T oBook) {
+   assert(oBook != NULL);
+   return oBook->lCount;
+}
+
+/*--------------------------------------------------------------------*/
+int Book_find(Book_T oBook, Board_T oBoard, int *piRow, int *piColumn,
+              int *piScore) {
+
+   const struct Book_Entry *psEntry;
+   struct Board_Packed sPacked, sCanonical;
+   uint64_t uKey;
+   long lLow, lHigh, lMiddle;
+   int iSymmetry, iMove;
+
+   assert(oBook != NULL);
+   assert(oBoard != NULL);
+   assert(piRow != NULL);
+   assert(piColumn != NULL);
+   assert(piScore != NULL);
+
+   Board_pack(oBoard, &sPacked);
+   iSymmetry = Board_canonical(&sPacked, &sCanonical);
+   uKey = makeKey(&sCanonical);
+
+   /* The entries are sorted by key. */
+   lLow = 0;
+   lHigh = oBook->lCount;
+   while (lLow < lHigh) {
+      lMiddle = lLow + (lHigh - lLow) / 2;
+      if (oBook->psEntries[lMiddle].uKey < uKey) lLow = lMiddle + 1;
+      else lHigh = lMiddle;
+   }
+   if (lLow == oBook->lCount || oBook->psEntries[lLow].uKey != uKey)
+      return 0;
+   psEntry = &oBook->psEntries[lLow];
+   if (psEntry->uMove >= SIZE * SIZE) return 0;
+
+   /* Any symmetry that turns the position into the one of the key
+      turns the move back into a move of the same worth. A move that
+      is not legal means that another position has the same key. */
+   iMove = Board_transformSquare(psEntry->uMove,
+                                 Board_inverseSymmetry(iSymmetry));
+   if ((Board_legalMoves(oBoard) & ((uint64_t)1 << iMove)) == 0)
+      return 0;
+   *piRow = iMove / SIZE;
+   *piColumn = iMove % SIZE;
+   *piScore = psEntry->iScore;
+   return 1;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,78 @@
+/*--------------------------------------------------------------------*/
+/* book.h                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef BOOK_INCLUDED
+#define BOOK_INCLUDED
+
+#include <stdint.h>
+#include "board.h"
+
+/* An opening book tells the best known move of positions early in the
+   game without searching them. A position is looked up by its key, a
+   hash of its canonical form, so that the symmetric copies of a
+   position share one entry. A book file is a header of BOOK_HEADER
+   bytes:
+
+      0  "OTHB"
+      4  the version, 1
+      8  the number of entries, as a uint64_t
+
+   followed by the entries, sorted by key. The count and the entries
+   are kept in the byte order of the machine, so the file is mapped
+   into memory and searched as it is: opening a book reads nothing,
+   however big it is. */
+
+/* Bytes of the header of a book file. */
+enum {BOOK_HEADER = 16};
+
+/* An entry of a book. */
+struct Book_Entry {
+   /* The key of the position, see Book_key. */
+   uint64_t uKey;
+
+   /* The average final score of the games that played the move, for
+      the player to move, and how many there were. */
+   int16_t iScore;
+   uint16_t uGames;
+
+   /* The move, row * 8 + column of the canonical form of the
+      position. */
+   uint8_t uMove;
+
+   uint8_t aucUnused[3];
+};
+
+/* A book file mapped into memory. */
+typedef struct Book *Book_T;
+
+/* Returns the key of the packed position *psPacked: a hash of its
+   canonical form (see Board_canonical). If iSquare is not -1, stores
+   in *piSquare the move to iSquare (row * 8 + column) as it is on the
+   canonical form, the same for every symmetric copy of the move. */
+uint64_t Book_key(const struct Board_Packed *psPacked, int iSquare,
+                  int *piSquare);
+
+/* Sorts the lCount entries of psEntries by key and writes them to the
+   book file pcFile. No two may have the same key. Returns 1 if
+   successful and 0 if not. */
+int Book_write(const char *pcFile, struct Book_Entry *psEntries,
+               long lCount);
+
+/* Maps the book file pcFile into memory. Returns the book, or NULL if
+   it cannot be mapped or is not a book file. */
+Book_T Book_open(const char *pcFile);
+
+/* Unmaps oBook and frees it. */
+void Book_close(Book_T oBook);
+
+/* Returns the number of entries of oBook. */
+long Book_getCount(Book_T oBook);
+
+/* Looks up the position on oBoard in oBook. If it is there, stores
+   the move in *piRow and *piColumn and its score for the current
+   player in *piScore, and returns 1. Returns 0 if it is not. */
+int Book_find(Book_T oBook, Board_T oBoard, int *piRow, int *piColumn,
+              int *piScore);
+
+#endif
@@ -0,0 +1,424 @@
+/*--------------------------------------------------------------------*/
+/* booktool.c                                                         */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for clock_gettime */
+#include <time.h>
+#include "board.h"
+#include "bitboard.h"
+#include "archive.h"
+#include "book.h"
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Bytes of a position in a self-play shard (see selfplay.c). */
+enum {POSITION_BYTES = 18};
+
+/* The options that are not given: moves of each game that go into the
+   book, and fewest games that must have played a move for it to go
+   in. */
+enum {PLIES = 20, MIN_GAMES = 2};
+
+/* Number of times a position is looked up to time it. */
+enum {LOOKUPS = 100000};
+
+/*--------------------------------------------------------------------*/
+
+/* One move of one game: the key of the position it was played on, the
+   move as Book_key turns it and the final score of the game for the
+   player that made it. */
+struct Sample {
+   uint64_t uKey;
+   int iScore;
+   int iMove;
+};
+
+/* The moves gathered from the games that a book is built from. */
+struct Builder {
+   /* The samples, how many there are and how many fit. */
+   struct Sample *psSamples;
+   long lCount;
+   long lSize;
+
+   /* The moves of each game that are taken. */
+   int iPlies;
+
+   /* The number of games taken. */
+   long lGames;
+};
+
+/*--------------------------------------------------------------------*/
+/* Adds the first moves of the game with the iMoves moves of pucMoves
+   (row * 8 + column each, passes left out), which ended with the score
+   iScore for FIRST, to psBuilder. Returns 1 if successful, or 0 if
+   there is not enough memory or a move is not valid. */
+
+static int addGame(struct Builder *psBuilder,
+                   const unsigned char *pucMoves, int iMoves,
+                   int iScore) {
+
+   struct Board_Storage sBoard;
+   struct Board_Packed sPacked;
+   struct Sample *psMore;
+   Board_T oBoard;
+   int i, player, iSquare, iMove;
+
+   oBoard = Board_initIn(&sBoard, 0, NULL);
+   for (i = 0; i < iMoves && i < psBuilder->iPlies; i++) {
+      iSquare = pucMoves[i];
+      if (iSquare >= SIZE * SIZE
+          || Board_moveIsValid(oBoard, iSquare / SIZE,
+                               iSquare % SIZE) == 0)
+         return 0;
+      if (psBuilder->lCount == psBuilder->lSize) {
+         psMore = realloc(psBuilder->psSamples,
+                          (size_t)(psBuilder->lSize * 2 + 1024)
+                          * sizeof(struct Sample));
+         if (psMore == NULL) return 0;
+         psBuilder->psSamples = psMore;
+         psBuilder->lSize = psBuilder->lSize * 2 + 1024;
+      }
+      player = Board_getPlayer(oBoard);
+      Board_pack(oBoard, &sPacked);
+      psBuilder->psSamples[psBuilder->lCount].uKey =
+         Book_key(&sPacked, iSquare, &iMove);
+      psBuilder->psSamples[psBuilder->lCount].iMove = iMove;
+      psBuilder->psSamples[psBuilder->lCount].iScore =
+         (player == 1) ? iScore : -iScore;
+      psBuilder->lCount++;
+
+      /* Board_draw makes the passes. */
+      Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+      if (Board_draw(oBoard) == 0) break;
+   }
+   psBuilder->lGames++;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Adds the games of the archive oArchive that were played to the end
+   to psBuilder. pcFile is the name of the archive. Returns 1 if
+   successful and 0 if not. */
+
+static int addArchive(struct Builder *psBuilder, Archive_T oArchive,
+                      const char *pcFile) {
+
+   struct Record_Game sGame;
+   unsigned char aucMoves[RECORD_MAX_MOVES];
+   long lGame;
+   int i, iMoves;
+
+   for (lGame = 0; lGame < Archive_getCount(oArchive); lGame++) {
+      if (Archive_getGame(oArchive, lGame, &sGame) == 0) {
+         fprintf(stderr, "%s: game %ld is damaged\n", pcFile,
+                 lGame + 1);
+         return 0;
+      }
+      if (sGame.iEnd != RECORD_FINISHED) continue;
+      iMoves = 0;
+      for (i = 0; i < sGame.iMoves; i++)
+         if (sGame.aucMoves[i] != RECORD_PASS)
+            aucMoves[iMoves++] = sGame.aucMoves[i];
+      if (addGame(psBuilder, aucMoves, iMoves, sGame.iScore) == 0) {
+         fprintf(stderr, "%s: cannot add game %ld\n", pcFile,
+                 lGame + 1);
+         return 0;
+      }
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the bitboard stored in pucBytes, least significant byte
+   first. */
+
+static uint64_t getBitboard(const unsigned char *pucBytes) {
+
+   uint64_t u;
+   int i;
+
+   u = 0;
+   for (i = 7; i >= 0; i--) u = (u << 8) | pucBytes[i];
+   return u;
+}
+
+/*--------------------------------------------------------------------*/
+/* Adds the games of the self-play shard pcFile to psBuilder. A shard
+   holds every position of each game but the last, so a position that
+   has one tile more than the one before it, and every tile of it,
+   follows it in the same game, and the new tile is the move between
+   them. Returns 1 if successful and 0 if not. */
+
+static int addShard(struct Builder *psBuilder, const char *pcFile) {
+
+   FILE *psFile;
+   unsigned char aucPosition[POSITION_BYTES];
+   unsigned char aucMoves[SIZE * SIZE];
+   uint64_t uTiles, uLast, uNew;
+   int iMoves, iScore, iOk;
+   size_t ulRead;
+
+   psFile = fopen(pcFile, "rb");
+   if (psFile == NULL) {
+      perror(pcFile);
+      return 0;
+   }
+   iOk = 1;
+   iMoves = 0;
+   iScore = 0;
+   uLast = 0;
+   for (;;) {
+      ulRead = fread(aucPosition, 1, POSITION_BYTES, psFile);
+      if (ulRead != POSITION_BYTES) {
+         if (ulRead != 0 || ferror(psFile)) {
+            fprintf(stderr, "%s is not a shard\n", pcFile);
+            iOk = 0;
+         }
+         break;
+      }
+      uTiles = getBitboard(aucPosition) | getBitboard(aucPosition + 8);
+      uNew = uTiles & ~uLast;
+      if (uLast != 0 && (uTiles & uLast) == uLast
+          && Bitboard_count(uNew) == 1)
+         aucMoves[iMoves++] = (unsigned char)Bitboard_first(uNew);
+      else {
+         /* A new game, so the one before it is whole. */
+         if (iMoves > 0
+             && addGame(psBuilder, aucMoves, iMoves, iScore) == 0) {
+            fprintf(stderr, "%s: cannot add its games\n", pcFile);
+            iOk = 0;
+            break;
+         }
+         iMoves = 0;
+      }
+      iScore = (signed char)aucPosition[17];
+      uLast = uTiles;
+   }
+   if (iOk == 1 && iMoves > 0
+       && addGame(psBuilder, aucMoves, iMoves, iScore) == 0) {
+      fprintf(stderr, "%s: cannot add its games\n", pcFile);
+      iOk = 0;
+   }
+   fclose(psFile);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+/* Compares the struct Sample pvFirst and pvSecond by key and then by
+   move. Returns a negative number, 0 or a positive number if the
+   first is smaller, the same or larger. */
+
+static int compareSamples(const void *pvFirst, const void *pvSecond) {
+
+   const struct Sample *psFirst, *psSecond;
+
+   psFirst = (const struct Sample *)pvFirst;
+   psSecond = (const struct Sample *)pvSecond;
+   if (psFirst->uKey != psSecond->uKey)
+      return (psFirst->uKey > psSecond->uKey) ? 1 : -1;
+   return psFirst->iMove - psSecond->iMove;
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the book pcFile from the samples of psBuilder: for each
+   position, the move with the best average score of those that at
+   least iMinGames games played. Returns the number of entries, or -1
+   if there is not enough memory or the book cannot be written. */
+
+static long writeBook(struct Builder *psBuilder, const char *pcFile,
+                      int iMinGames) {
+
+   struct Book_Entry *psEntries;
+   const struct Sample *psSamples;
+   long lCount, lEntries, lFirst, lEnd, lGames, lSum;
+   long lBestGames, lBestSum;
+   int iBestMove;
+
+   qsort(psBuilder->psSamples, (size_t)psBuilder->lCount,
+         sizeof(struct Sample), compareSamples);
+   psSamples = psBuilder->psSamples;
+   lCount = psBuilder->lCount;
+
+   psEntries = calloc((size_t)lCount + 1, sizeof(struct Book_Entry));
+   if (psEntries == NULL) return -1;
+   lEntries = 0;
+   for (lFirst = 0; lFirst < lCount; lFirst = lEnd) {
+      /* Go through the moves of one position, each a run of samples. */
+      iBestMove = -1;
+      lBestGames = lBestSum = 0;
+      for (lEnd = lFirst; lEnd < lCount
+              && psSamples[lEnd].uKey == psSamples[lFirst].uKey; ) {
+         lGames = lSum = 0;
+         do {
+            lSum += psSamples[lEnd].iScore;
+            lGames++;
+            lEnd++;
+         } while (lEnd < lCount
+                  && psSamples[lEnd].uKey == psSamples[lFirst].uKey
+                  && psSamples[lEnd].iMove == psSamples[lEnd - 1].iMove);
+
+         /* Compare the averages without dividing. */
+         if (lGames >= iMinGames
+             && (iBestMove == -1 || lSum * lBestGames > lBestSum * lGames
+                 || (lSum * lBestGames == lBestSum * lGames
+                     && lGames > lBestGames))) {
+            iBestMove = psSamples[lEnd - 1].iMove;
+            lBestGames = lGames;
+            lBestSum = lSum;
+         }
+      }
+      if (iBestMove == -1) continue;
+      psEntries[lEntries].uKey = psSamples[lFirst].uKey;
+      psEntries[lEntries].iScore = (int16_t)(lBestSum / lBestGames);
+      psEntries[lEntries].uGames =
+         (uint16_t)(lBestGames > 0xFFFF ? 0xFFFF : lBestGames);
+      psEntries[lEntries].uMove = (uint8_t)iBestMove;
+      lEntries++;
+   }
+   if (Book_write(pcFile, psEntries, lEntries) == 0) lEntries = -1;
+   free(psEntries);
+   return lEntries;
+}
+
+/*--------------------------------------------------------------------*/
+/* Builds the book pcBook from the iFiles archives and self-play shards
+   named in ppcFiles, taking the first iPlies moves of each game and
+   the moves at least iMinGames games played. Prints how many games,
+   moves and entries there were. Returns 1 if successful and 0 if
+   not. */
+
+static int buildBook(const char *pcBook, char *ppcFiles[], int iFiles,
+                     int iPlies, int iMinGames) {
+
+   struct Builder sBuilder;
+   Archive_T oArchive;
+   long lEntries;
+   int i, iOk;
+
+   memset(&sBuilder, 0, sizeof(sBuilder));
+   sBuilder.iPlies = iPlies;
+   iOk = 1;
+   for (i = 0; iOk == 1 && i < iFiles; i++) {
+      /* Anything that is not an archive with an index is taken to be
+         a shard. */
+      oArchive = Archive_open(ppcFiles[i]);
+      if (oArchive != NULL) {
+         iOk = addArchive(&sBuilder, oArchive, ppcFiles[i]);
+         Archive_close(oArchive);
+      }
+      else iOk = addShard(&sBuilder, ppcFiles[i]);
+   }
+   if (iOk == 1) {
+      lEntries = writeBook(&sBuilder, pcBook, iMinGames);
+      if (lEntries == -1) {
+         fprintf(stderr, "cannot write %s\n", pcBook);
+         iOk = 0;
+      }
+      else
+         printf("%ld games, %ld moves, %ld positions in %s\n",
+                sBuilder.lGames, sBuilder.lCount, lEntries, pcBook);
+   }
+   free(sBuilder.psSamples);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays the iMoves moves of ppcMoves, each a column letter followed
+   by a row number, from the initial position and looks the position
+   they reach up in the book pcBook. Prints the move of the book and
+   how long a lookup takes. Returns 1 if successful and 0 if not. */
+
+static int findMove(const char *pcBook, char *ppcMoves[], int iMoves) {
+
+   struct Board_Storage sBoard;
+   struct timespec sStart, sEnd;
+   Book_T oBook;
+   Board_T oBoard;
+   char columnChar;
+   int i, row, column, iScore, iFound, iOver;
+   double dTime;
+
+   oBook = Book_open(pcBook);
+   if (oBook == NULL) {
+      fprintf(stderr, "cannot open the book %s\n", pcBook);
+      return 0;
+   }
+   oBoard = Board_initIn(&sBoard, 0, NULL);
+   iOver = 0;
+   for (i = 0; i < iMoves; i++) {
+      columnChar = ' ';
+      if (sscanf(ppcMoves[i], "%c%d", &columnChar, &row) != 2) row = -1;
+      column = (int)(columnChar - 'A');
+      if (iOver == 1 || Board_moveIsValid(oBoard, row, column) == 0) {
+         fprintf(stderr, "%s is not a valid move\n", ppcMoves[i]);
+         Book_close(oBook);
+         return 0;
+      }
+
+      /* Board_draw makes the passes. */
+      Board_makeMove(oBoard, row, column);
+      iOver = (Board_draw(oBoard) == 0);
+   }
+
+   iFound = 0;
+   clock_gettime(CLOCK_MONOTONIC, &sStart);
+   for (i = 0; i < LOOKUPS; i++)
+      iFound = Book_find(oBook, oBoard, &row, &column, &iScore);
+   clock_gettime(CLOCK_MONOTONIC, &sEnd);
+   dTime = (double)(sEnd.tv_sec - sStart.tv_sec) * 1e6
+      + (double)(sEnd.tv_nsec - sStart.tv_nsec) / 1e3;
+
+   if (iFound == 1)
+      printf("%c%d, score %d\n", (char)('A' + column), row, iScore);
+   else printf("not in the book\n");
+   printf("%ld positions, lookup in %.3f us\n", Book_getCount(oBook),
+          dTime / LOOKUPS);
+   Book_close(oBook);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Builds an opening book or looks a position up in one:
+
+      booktool -build [-plies n] [-min n] book file...
+      booktool book [move...]
+
+   The first builds book from the games of the archives and self-play
+   shards given, taking the first -plies moves of each game, and of
+   them the ones that at least -min games played. The second looks up
+   the position that the moves given lead to. argc is the command line
+   argument count and argv the arguments. Returns 0, or EXIT_FAILURE
+   if the arguments are not valid or the book cannot be built or
+   read. */
+
+int main(int argc, char *argv[]) {
+
+   int i, iPlies, iMinGames, iOk;
+
+   if (argc >= 2 && strcmp(argv[1], "-build") == 0) {
+      iPlies = PLIES;
+      iMinGames = MIN_GAMES;
+      for (i = 2; i + 1 < argc; i += 2) {
+         if (strcmp(argv[i], "-plies") == 0) iPlies = atoi(argv[i + 1]);
+         else if (strcmp(argv[i], "-min") == 0)
+            iMinGames = atoi(argv[i + 1]);
+         else break;
+      }
+      if (i + 1 < argc && argv[i][0] != '-' && iPlies >= 1
+          && iMinGames >= 1) {
+         iOk = buildBook(argv[i], &argv[i + 1], argc - i - 1, iPlies,
+                         iMinGames);
+         return (iOk == 1) ? 0 : EXIT_FAILURE;
+      }
+   }
+   else if (argc >= 2 && argv[1][0] != '-') {
+      iOk = findMove(argv[1], &argv[2], argc - 2);
+      return (iOk == 1) ? 0 : EXIT_FAILURE;
+   }
+   fprintf(stderr, "Usage: %s -build [-plies n] [-min n] book file...\n"
+           "       %s book [move...]\n", argv[0], argv[0]);
+   return EXIT_FAILURE;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,532 @@
+/*--------------------------------------------------------------------*/
+/* endgame.c                                                          */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#include "endgame.h"
+#include "bitboard.h"
+#include "metrics.h"
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Number of tiles on the board. */
+enum {TILES = 64};
+
+/* Larger than any final score. */
+enum {INFINITE_SCORE = TILES + 1};
+
+/* Empty tiles at and below which the last moves are tried straight
+   from the list of empty tiles, without a legal move mask, by
+   solveLast, solveTwo, solveThree or solveFour: one routine for each
+   count, so it cannot be raised without adding another. */
+enum {FEW_EMPTIES = 4};
+
+/* Empty tiles from which moves are tried in order of the other
+   player's mobility after them, and positions are kept in the hash
+   table. Below them moves are tried in order of parity only. */
+enum {ORDER_EMPTIES = 7};
+
+/* How much more a move the other player can make now counts than one
+   it may make later, in ordering moves. */
+enum {MOBILITY_WEIGHT = 4};
+
+/* Number of bits of the index of the hash table. */
+enum {HASH_BITS = 18};
+
+/* Number of positions searched between checks of the clock. */
+enum {CLOCK_CHECK = 4096};
+
+/* The tiles of the A and H columns and of the first and last rows. */
+#define A_FILE 0x0101010101010101ULL
+#define H_FILE 0x8080808080808080ULL
+#define FIRST_RANK 0x00000000000000FFULL
+#define LAST_RANK 0xFF00000000000000ULL
+
+/* The corners. */
+#define CORNERS 0x8100000000000081ULL
+
+/*--------------------------------------------------------------------*/
+
+/* The four quadrants of the board. Moves into a quadrant with an odd
+   number of empty tiles are tried first: the player who moves last in
+   a region usually gains from it. */
+static const uint64_t auQuadrant[4] = {
+   0x000000000F0F0F0FULL, 0x00000000F0F0F0F0ULL,
+   0x0F0F0F0F00000000ULL, 0xF0F0F0F000000000ULL
+};
+
+/* The diagonals running down to the right, by column less row. */
+static const uint64_t auDiagonal[15] = {
+   0x0100000000000000ULL, 0x0201000000000000ULL, 0x0402010000000000ULL,
+   0x0804020100000000ULL, 0x1008040201000000ULL, 0x2010080402010000ULL,
+   0x4020100804020100ULL, 0x8040201008040201ULL, 0x0080402010080402ULL,
+   0x0000804020100804ULL, 0x0000008040201008ULL, 0x0000000080402010ULL,
+   0x0000000000804020ULL, 0x0000000000008040ULL, 0x0000000000000080ULL
+};
+
+/* The diagonals running down to the left, by column plus row. */
+static const uint64_t auAntiDiagonal[15] = {
+   0x0000000000000001ULL, 0x0000000000000102ULL, 0x0000000000010204ULL,
+   0x0000000001020408ULL, 0x0000000102040810ULL, 0x0000010204081020ULL,
+   0x0001020408102040ULL, 0x0102040810204080ULL, 0x0204081020408000ULL,
+   0x0408102040800000ULL, 0x0810204080000000ULL, 0x1020408000000000ULL,
+   0x2040800000000000ULL, 0x4080000000000000ULL, 0x8000000000000000ULL
+};
+
+/* What is known about one position: bounds on its score and its best
+   move. */
+struct Entry {
+   uint64_t uOwn;
+   uint64_t uOpp;
+   int8_t iLower;
+   int8_t iUpper;
+   uint8_t uMove;
+};
+
+/* A move and the key it is ordered by, smallest first. */
+struct Move {
+   int iSquare;
+   int iKey;
+   uint64_t uFlips;
+};
+
+/* The state of one solve. */
+struct Solver {
+   /* The time at which the solve has to stop, in milliseconds of the
+      monotonic clock, or 0 if it has no time limit. */
+   long lDeadline;
+
+   /* The number of positions searched so far. */
+   long lNodes;
+
+   /* The hash table, with 1 << HASH_BITS entries, or NULL if the
+      position is too small to need one. */
+   struct Entry *psTable;
+
+   /* Whether the solve ran out of time. */
+   int iAborted;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns the final score of a finished game for the player with the
+   tiles uOwn against the tiles uOpp. */
+
+static int finalScore(uint64_t uOwn, uint64_t uOpp) {
+   return Bitboard_count(uOwn) - Bitboard_count(uOpp);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the number of tiles of uEmpty beside, above or below a tile
+   of uTiles: the tiles where the other player may one day be able to
+   move. */
+
+static int countFrontier(uint64_t uTiles, uint64_t uEmpty) {
+
+   uint64_t uWest, uEast;
+
+   uWest = (uTiles & ~A_FILE) >> 1;
+   uEast = (uTiles & ~H_FILE) << 1;
+   return Bitboard_count(uEmpty & (uWest | uEast | (uTiles << 8)
+                                   | (uTiles >> 8)));
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the tiles of uOwn that can never be flipped, whatever the
+   player with the tiles uOpp does. Not every such tile is found, but
+   each one returned is stable: in each of the four directions it
+   either lies on a full line or is next to the edge or to another
+   stable tile of its own. */
+
+static uint64_t stableTiles(uint64_t uOwn, uint64_t uOpp) {
+
+   uint64_t uFull, uRows, uColumns, uDiagonals, uAntiDiagonals;
+   uint64_t uStable, uLast;
+   int i;
+
+   uFull = uOwn | uOpp;
+   uRows = uColumns = uDiagonals = uAntiDiagonals = 0;
+   for (i = 0; i < SIZE; i++) {
+      if ((uFull & (FIRST_RANK << (SIZE * i))) == FIRST_RANK << (SIZE * i))
+         uRows |= FIRST_RANK << (SIZE * i);
+      if ((uFull & (A_FILE << i)) == A_FILE << i)
+         uColumns |= A_FILE << i;
+   }
+   for (i = 0; i < 2 * SIZE - 1; i++) {
+      if ((uFull & auDiagonal[i]) == auDiagonal[i])
+         uDiagonals |= auDiagonal[i];
+      if ((uFull & auAntiDiagonal[i]) == auAntiDiagonal[i])
+         uAntiDiagonals |= auAntiDiagonal[i];
+   }
+
+   /* Grow the stable tiles from the edges until no more are found. */
+   uStable = 0;
+   do {
+      uLast = uStable;
+      uStable |= uOwn
+         & (uRows | (uStable << 1) | (uStable >> 1) | A_FILE | H_FILE)
+         & (uColumns | (uStable << 8) | (uStable >> 8) | FIRST_RANK
+            | LAST_RANK)
+         & (uDiagonals | (uStable << 9) | (uStable >> 9) | A_FILE
+            | H_FILE | FIRST_RANK | LAST_RANK)
+         & (uAntiDiagonals | (uStable << 7) | (uStable >> 7) | A_FILE
+            | H_FILE | FIRST_RANK | LAST_RANK);
+   } while (uStable != uLast);
+   return uStable;
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the score of the game for the player with the tiles uOwn
+   against the tiles uOpp when only the tile iSquare is empty. */
+
+static int solveLast(struct Solver *psSolver, uint64_t uOwn,
+                     uint64_t uOpp, int iSquare) {
+
+   uint64_t uFlips;
+   int iScore;
+
+   psSolver->lNodes++;
+   iScore = finalScore(uOwn, uOpp);
+   uFlips = Bitboard_flips(uOwn, uOpp, iSquare);
+   if (uFlips != 0) return iScore + 1 + 2 * Bitboard_count(uFlips);
+
+   /* The other player gets the last move if it has one. */
+   uFlips = Bitboard_flips(uOpp, uOwn, iSquare);
+   if (uFlips != 0) return iScore - 1 - 2 * Bitboard_count(uFlips);
+   return iScore;
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the score of the game for the player with the tiles uOwn
+   against the tiles uOpp with the window iAlpha, iBeta, when only the
+   tiles iFirst and iSecond are empty, iFirst to be tried first.
+   iPassed is 1 if the other player just had to pass. */
+
+static int solveTwo(struct Solver *psSolver, uint64_t uOwn,
+                    uint64_t uOpp, int iFirst, int iSecond,
+                    int iAlpha, int iBeta, int iPassed) {
+
+   uint64_t uFlips;
+   int iScore, iBest;
+
+   psSolver->lNodes++;
+   iBest = -INFINITE_SCORE;
+   uFlips = Bitboard_flips(uOwn, uOpp, iFirst);
+   if (uFlips != 0) {
+      uFlips |= (uint64_t)1 << iFirst;
+      iBest = -solveLast(psSolver, uOpp & ~uFlips, uOwn | uFlips,
+                         iSecond);
+      if (iBest >= iBeta) return iBest;
+   }
+   uFlips = Bitboard_flips(uOwn, uOpp, iSecond);
+   if (uFlips != 0) {
+      uFlips |= (uint64_t)1 << iSecond;
+      iScore = -solveLast(psSolver, uOpp & ~uFlips, uOwn | uFlips,
+                          iFirst);
+      if (iScore > iBest) iBest = iScore;
+   }
+   if (iBest != -INFINITE_SCORE) return iBest;
+
+   /* The player has to pass, or the game is over. */
+   if (iPassed == 1) return finalScore(uOwn, uOpp);
+   return -solveTwo(psSolver, uOpp, uOwn, iFirst, iSecond, -iBeta,
+                    -iAlpha, 1);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the score of the game for the player with the tiles uOwn
+   against the tiles uOpp with the window iAlpha, iBeta, when only the
+   three tiles in aiEmpty are empty, to be tried in that order.
+   iPassed is 1 if the other player just had to pass. */
+
+static int solveThree(struct Solver *psSolver, uint64_t uOwn,
+                      uint64_t uOpp, const int *aiEmpty, int iAlpha,
+                      int iBeta, int iPassed) {
+
+   /* The two tiles left after a move to each tile, in order. */
+   static const int aiOther[3][2] = {{1, 2}, {0, 2}, {0, 1}};
+   uint64_t uFlips;
+   int i, iScore, iBest;
+
+   psSolver->lNodes++;
+   iBest = -INFINITE_SCORE;
+   for (i = 0; i < 3; i++) {
+      uFlips = Bitboard_flips(uOwn, uOpp, aiEmpty[i]);
+      if (uFlips == 0) continue;
+      uFlips |= (uint64_t)1 << aiEmpty[i];
+      iScore = -solveTwo(psSolver, uOpp & ~uFlips, uOwn | uFlips,
+                         aiEmpty[aiOther[i][0]], aiEmpty[aiOther[i][1]],
+                         -iBeta, -iAlpha, 0);
+      if (iScore > iBest) {
+         iBest = iScore;
+         if (iBest > iAlpha) iAlpha = iBest;
+         if (iAlpha >= iBeta) break;
+      }
+   }
+   if (iBest != -INFINITE_SCORE) return iBest;
+
+   /* The player has to pass, or the game is over. */
+   if (iPassed == 1) return finalScore(uOwn, uOpp);
+   return -solveThree(psSolver, uOpp, uOwn, aiEmpty, -iBeta, -iAlpha,
+                      1);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the score of the game for the player with the tiles uOwn
+   against the tiles uOpp with the window iAlpha, iBeta, when only the
+   four tiles in aiEmpty are empty, to be tried in that order.
+   iPassed is 1 if the other player just had to pass. */
+
+static int solveFour(struct Solver *psSolver, uint64_t uOwn,
+                     uint64_t uOpp, const int *aiEmpty, int iAlpha,
+                     int iBeta, int iPassed) {
+
+   uint64_t uFlips;
+   int aiRest[3];
+   int i, j, iScore, iBest;
+
+   psSolver->lNodes++;
+   iBest = -INFINITE_SCORE;
+   for (i = 0; i < 4; i++) {
+      uFlips = Bitboard_flips(uOwn, uOpp, aiEmpty[i]);
+      if (uFlips == 0) continue;
+
+      /* The empty tiles after the move, in the same order. */
+      for (j = 0; j < 3; j++)
+         aiRest[j] = aiEmpty[j < i ? j : j + 1];
+      uFlips |= (uint64_t)1 << aiEmpty[i];
+      iScore = -solveThree(psSolver, uOpp & ~uFlips, uOwn | uFlips,
+                           aiRest, -iBeta, -iAlpha, 0);
+      if (iScore > iBest) {
+         iBest = iScore;
+         if (iBest > iAlpha) iAlpha = iBest;
+         if (iAlpha >= iBeta) break;
+      }
+   }
+   if (iBest != -INFINITE_SCORE) return iBest;
+
+   /* The player has to pass, or the game is over. */
+   if (iPassed == 1) return finalScore(uOwn, uOpp);
+   return -solveFour(psSolver, uOpp, uOwn, aiEmpty, -iBeta, -iAlpha, 1);
+}
+
+/*--------------------------------------------------------------------*/
+/* Stores in psMoves the moves uMoves of the player with the tiles
+   uOwn against the tiles uOpp, the empty tiles being uEmpty, in the
+   order they should be tried: iFirst first if it is one of them, and
+   then, if iOrder is 1, those that leave the other player the fewest
+   moves now and the fewest tiles to move to later, corners first among
+   equals, or else those in quadrants with an odd number of empty
+   tiles. Returns the number of moves. */
+
+static int orderMoves(struct Move *psMoves, uint64_t uMoves,
+                      uint64_t uOwn, uint64_t uOpp, uint64_t uEmpty,
+                      int iFirst, int iOrder) {
+
+   struct Move sMove;
+   uint64_t uOdd, uBit, uAfter;
+   int i, j, iCount;
+
+   uOdd = 0;
+   for (i = 0; i < 4; i++)
+      if ((Bitboard_count(uEmpty & auQuadrant[i]) & 1) == 1)
+         uOdd |= auQuadrant[i];
+
+   iCount = 0;
+   while (uMoves != 0) {
+      sMove.iSquare = Bitboard_first(uMoves);
+      uBit = (uint64_t)1 << sMove.iSquare;
+      uMoves &= uMoves - 1;
+      sMove.uFlips = Bitboard_flips(uOwn, uOpp, sMove.iSquare);
+      if (sMove.iSquare == iFirst) sMove.iKey = -TILES;
+      else if (iOrder == 1) {
+         uAfter = uOwn | sMove.uFlips | uBit;
+         sMove.iKey = MOBILITY_WEIGHT * Bitboard_count(
+            Bitboard_legalMoves(uOpp & ~sMove.uFlips, uAfter))
+            + countFrontier(uAfter, uEmpty & ~uBit)
+            - 2 * ((uBit & CORNERS) != 0) - ((uBit & uOdd) != 0);
+      }
+      else sMove.iKey = ((uBit & uOdd) == 0);
+
+      /* Insert the move in order; there are only a few. */
+      for (j = iCount; j > 0 && psMoves[j - 1].iKey > sMove.iKey; j--)
+         psMoves[j] = psMoves[j - 1];
+      psMoves[j] = sMove;
+      iCount++;
+   }
+   return iCount;
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the score of the game for the player with the tiles uOwn
+   against the tiles uOpp with the window iAlpha, iBeta for the solve
+   psSolver, when iEmpty tiles are empty. iPassed is 1 if the other
+   player just had to pass. If piBest is not NULL, stores the best
+   move in it. Returns 0 if the solve ran out of time. */
+
+static int solve(struct Solver *psSolver, uint64_t uOwn, uint64_t uOpp,
+                 int iEmpty, int iAlpha, int iBeta, int iPassed,
+                 int *piBest) {
+
+   struct Move asMoves[TILES];
+   struct Entry *psEntry;
+   uint64_t uEmpty, uMoves, uBit, uOdd;
+   int aiEmpty[FEW_EMPTIES];
+   int i, iCount, iScore, iBest, iBestMove, iFirst, iAlpha0, iBound;
+
+   psSolver->lNodes++;
+   if (psSolver->lDeadline != 0 && psSolver->lNodes % CLOCK_CHECK == 0
+       && Metrics_millis() >= psSolver->lDeadline)
+      psSolver->iAborted = 1;
+   if (psSolver->iAborted == 1) return 0;
+
+   uEmpty = ~(uOwn | uOpp);
+
+   /* List the last few empty tiles, those in odd quadrants first. */
+   if (iEmpty <= FEW_EMPTIES && piBest == NULL) {
+      uOdd = 0;
+      for (i = 0; i < 4; i++)
+         if ((Bitboard_count(uEmpty & auQuadrant[i]) & 1) == 1)
+            uOdd |= auQuadrant[i];
+      iCount = 0;
+      for (uBit = uEmpty & uOdd; uBit != 0; uBit &= uBit - 1)
+         aiEmpty[iCount++] = Bitboard_first(uBit);
+      for (uBit = uEmpty & ~uOdd; uBit != 0; uBit &= uBit - 1)
+         aiEmpty[iCount++] = Bitboard_first(uBit);
+      if (iEmpty == 1) return solveLast(psSolver, uOwn, uOpp, aiEmpty[0]);
+      if (iEmpty == 2)
+         return solveTwo(psSolver, uOwn, uOpp, aiEmpty[0], aiEmpty[1],
+                         iAlpha, iBeta, iPassed);
+      if (iEmpty == 3)
+         return solveThree(psSolver, uOwn, uOpp, aiEmpty, iAlpha, iBeta,
+                           iPassed);
+      return solveFour(psSolver, uOwn, uOpp, aiEmpty, iAlpha, iBeta,
+                       iPassed);
+   }
+
+   /* The other player keeps its stable tiles, so if even winning all
+      the rest is not enough, stop here. */
+   iBound = TILES - 2 * Bitboard_count(uOpp);
+   if (iBound <= iAlpha) {
+      iBound = TILES - 2 * Bitboard_count(stableTiles(uOpp, uOwn));
+      if (iBound <= iAlpha && piBest == NULL) return iBound;
+   }
+
+   /* Use what is known about the position already. */
+   psEntry = NULL;
+   iFirst = -1;
+   if (psSolver->psTable != NULL && iEmpty >= ORDER_EMPTIES) {
+      psEntry = &psSolver->psTable[((uOwn * 0x9E3779B97F4A7C15ULL)
+                                    ^ (uOpp * 0xC2B2AE3D27D4EB4FULL))
+                                   >> (64 - HASH_BITS)];
+      if (psEntry->uOwn == uOwn && psEntry->uOpp == uOpp) {
+         if (piBest == NULL) {
+            if (psEntry->iLower >= iBeta) return psEntry->iLower;
+            if (psEntry->iUpper <= iAlpha) return psEntry->iUpper;
+            if (psEntry->iLower == psEntry->iUpper)
+               return psEntry->iLower;
+         }
+         iFirst = psEntry->uMove;
+      }
+   }
+
+   uMoves = Bitboard_legalMoves(uOwn, uOpp);
+   if (uMoves == 0) {
+      /* The player has to pass, or the game is over. */
+      if (iPassed == 1) return finalScore(uOwn, uOpp);
+      return -solve(psSolver, uOpp, uOwn, iEmpty, -iBeta, -iAlpha, 1,
+                    NULL);
+   }
+
+   iCount = orderMoves(asMoves, uMoves, uOwn, uOpp, uEmpty, iFirst,
+                       iEmpty >= ORDER_EMPTIES);
+   iAlpha0 = iAlpha;
+   iBest = -INFINITE_SCORE;
+   iBestMove = asMoves[0].iSquare;
+   for (i = 0; i < iCount; i++) {
+      uBit = asMoves[i].uFlips | ((uint64_t)1 << asMoves[i].iSquare);
+
+      /* Search the first move with the whole window, and the others
+         only to prove they are no better, unless they are. */
+      if (i == 0)
+         iScore = -solve(psSolver, uOpp & ~uBit, uOwn | uBit,
+                         iEmpty - 1, -iBeta, -iAlpha, 0, NULL);
+      else {
+         iScore = -solve(psSolver, uOpp & ~uBit, uOwn | uBit,
+                         iEmpty - 1, -iAlpha - 1, -iAlpha, 0, NULL);
+         if (iScore > iAlpha && iScore < iBeta)
+            iScore = -solve(psSolver, uOpp & ~uBit, uOwn | uBit,
+                            iEmpty - 1, -iBeta, -iScore, 0, NULL);
+      }
+      if (psSolver->iAborted == 1) return 0;
+
+      if (iScore > iBest) {
+         iBest = iScore;
+         iBestMove = asMoves[i].iSquare;
+         if (iBest > iAlpha) iAlpha = iBest;
+         if (iAlpha >= iBeta) break;
+      }
+   }
+
+   if (psEntry != NULL) {
+      if (psEntry->uOwn != uOwn || psEntry->uOpp != uOpp) {
+         psEntry->uOwn = uOwn;
+         psEntry->uOpp = uOpp;
+         psEntry->iLower = -TILES;
+         psEntry->iUpper = TILES;
+      }
+      if (iBest > iAlpha0) psEntry->iLower = (int8_t)iBest;
+      if (iBest < iBeta) psEntry->iUpper = (int8_t)iBest;
+      psEntry->uMove = (uint8_t)iBestMove;
+   }
+   if (piBest != NULL) *piBest = iBestMove;
+   return iBest;
+}
+
+/*--------------------------------------------------------------------*/
+int Endgame_solve(Board_T oBoard, long lMillis,
+                  struct Endgame_Result *psResult) {
+
+   struct Solver sSolver;
+   uint64_t uOwn, uOpp;
+   int player, iEmpty, iBest;
+
+   assert(oBoard != NULL);
+   assert(psResult != NULL);
+
+   player = Board_getPlayer(oBoard);
+   uOwn = Board_getTiles(oBoard, player);
+   uOpp = Board_getTiles(oBoard, 3 - player);
+   iEmpty = TILES - Bitboard_count(uOwn | uOpp);
+
+   psResult->iRow = -1;
+   psResult->iColumn = -1;
+   psResult->lNodes = 0;
+   if (Bitboard_legalMoves(uOwn, uOpp) == 0) {
+      /* The referee's board only has no moves once the game is over. */
+      psResult->iScore = finalScore(uOwn, uOpp);
+      return 1;
+   }
+
+   sSolver.lDeadline = 0;
+   if (lMillis > 0) sSolver.lDeadline = Metrics_millis() + lMillis;
+   sSolver.lNodes = 0;
+   sSolver.iAborted = 0;
+   sSolver.psTable = NULL;
+   if (iEmpty > ORDER_EMPTIES) {
+      sSolver.psTable = calloc((size_t)1 << HASH_BITS,
+                               sizeof(struct Entry));
+      if (sSolver.psTable == NULL) return 0;
+   }
+
+   iBest = -1;
+   psResult->iScore = solve(&sSolver, uOwn, uOpp, iEmpty,
+                            -INFINITE_SCORE, INFINITE_SCORE, 0, &iBest);
+   psResult->lNodes = sSolver.lNodes;
+   free(sSolver.psTable);
+   if (sSolver.iAborted == 1) return 0;
+   psResult->iRow = iBest / SIZE;
+   psResult->iColumn = iBest % SIZE;
+   return 1;
+}
+/*--------------------------------------------------------------------*/
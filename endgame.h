@@ -0,0 +1,37 @@
+/*--------------------------------------------------------------------*/
+/* endgame.h                                                          */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef ENDGAME_INCLUDED
+#define ENDGAME_INCLUDED
+
+#include "board.h"
+
+/* What solving a position found out. */
+struct Endgame_Result {
+   /* The final score with perfect play by both players: the tiles of
+      the current player less the other player's, which is what
+      Board_endGame returns if the current player is FIRST. */
+   int iScore;
+
+   /* The row and column of a move that reaches iScore, or -1 if the
+      game is over. */
+   int iRow;
+   int iColumn;
+
+   /* The number of positions searched. */
+   long lNodes;
+};
+
+/* Finds the final score of the game on oBoard with perfect play, and
+   a move that reaches it, by searching every line to the end of the
+   game. Gives up after lMillis milliseconds of wall clock time (0 for
+   no limit). Stores what it found in *psResult. Returns 1 if the
+   position was solved and 0 if time ran out, when *psResult holds
+   only the number of positions searched. oBoard is left as it was.
+   Takes about a second with 20 empty tiles, and five to ten times as
+   long with every two more. */
+int Endgame_solve(Board_T oBoard, long lMillis,
+                  struct Endgame_Result *psResult);
+
+#endif
@@ -0,0 +1,459 @@
+/*--------------------------------------------------------------------*/
+/* engine.c                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <ctype.h>
+#include "board.h"
+#include "bitboard.h"
+#include "search.h"
+#include "endgame.h"
+#include "book.h"
+#include "eval.h"
+#include "protocol.h"
+#include "tt.h"
+#include "metrics.h"
+
+/* The time limits the engine assumes, in milliseconds, if the referee
+   does not give them in OTHELLO_MOVETIME and OTHELLO_GAMETIME: none
+   for a move and a minute for the game, as the referee does. */
+enum {MOVE_MILLIS = 0, GAME_MILLIS = 60000};
+
+/* Milliseconds the engine spends on a move if it has no limits. */
+enum {FREE_MILLIS = 1000};
+
+/* Milliseconds of the game limit kept in reserve, so that the engine
+   is never stopped by the limit. At most a twentieth of the limit is
+   kept. */
+enum {TIME_MARGIN = 3000};
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Number of tiles on the board. */
+enum {TILES = 64};
+
+/* Deepest search the engine makes. */
+enum {MAX_DEPTH = 60};
+
+/* Empty tiles at and below which the engine tries to solve the game
+   to the end before it searches. */
+enum {SOLVE_EMPTIES = 18};
+
+/* Threads the engine searches with if OTHELLO_THREADS does not say:
+   one, as the referee may run several engines at once. */
+enum {THREADS = 1};
+
+/* Bytes of memory for the transposition table. */
+enum {TT_BYTES = 64 * 1024 * 1024};
+
+/* Longest word read from the referee, including the null character. */
+enum {TOKEN_SIZE = 16};
+
+/* Bytes of input held at a time with the binary protocol. */
+enum {LINK_BUFFER = 256};
+
+/* How a game ends for playGame(). */
+enum {GAME_FINISHED, GAME_ENDED, GAME_EOF, GAME_INVALID};
+
+/* What readMove() can read from the referee. */
+enum {READ_MOVE, READ_WORD, READ_EOF};
+
+/*--------------------------------------------------------------------*/
+
+/* How the engine talks to the referee: with lines of text through
+   stdio, or with the frames of the binary protocol (see protocol.h)
+   through plain reads and writes of stdin and stdout. */
+struct Link {
+   /* Whether the binary protocol is spoken. */
+   int iBinary;
+
+   /* Input of the binary protocol that has been read but not used. */
+   unsigned char aucBuffer[LINK_BUFFER];
+   int iStart;
+   int iLength;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns the number in the environment variable pcName, such as a
+   time limit in milliseconds, or lDefault if it is not set. */
+
+static long getLimit(const char *pcName, long lDefault) {
+
+   char *pcValue;
+
+   pcValue = getenv(pcName);
+   if (pcValue == NULL || pcValue[0] == '\0') return lDefault;
+   return atol(pcValue);
+}
+
+/*--------------------------------------------------------------------*/
+/* Reads more of stdin into the buffer of psLink, which must have room
+   left. Returns 1 if successful and 0 at the end of stdin. */
+
+static int fillLink(struct Link *psLink) {
+
+   ssize_t lRead;
+
+   if (psLink->iStart > 0) {
+      memmove(psLink->aucBuffer, psLink->aucBuffer + psLink->iStart,
+              (size_t)psLink->iLength);
+      psLink->iStart = 0;
+   }
+   do
+      lRead = read(0, psLink->aucBuffer + psLink->iLength,
+                   (size_t)(LINK_BUFFER - psLink->iLength));
+   while (lRead == -1 && errno == EINTR);
+   if (lRead <= 0) return 0;
+   psLink->iLength += (int)lRead;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the ulLength bytes of pvBytes to the referee through psLink.
+   Returns 1 if successful and 0 if not. */
+
+static int writeLink(struct Link *psLink, const void *pvBytes,
+                     size_t ulLength) {
+
+   const char *pcBytes = pvBytes;
+   ssize_t lWritten;
+
+   if (psLink->iBinary == 0) {
+      return fwrite(pvBytes, 1, ulLength, stdout) == ulLength
+         && fflush(stdout) != EOF;
+   }
+   while (ulLength > 0) {
+      lWritten = write(1, pcBytes, ulLength);
+      if (lWritten == -1 && errno == EINTR) continue;
+      if (lWritten <= 0) return 0;
+      pcBytes += lWritten;
+      ulLength -= (size_t)lWritten;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Reads the next word from the referee through psLink into acWord,
+   which holds TOKEN_SIZE characters: a run of characters that are not
+   white space, cut short if it is too long. With the binary protocol
+   the white space character that ends the word is read too, so that
+   the newline of a line is not taken for a frame. Returns 1 if
+   successful and 0 at the end of stdin. */
+
+static int readWord(struct Link *psLink, char *acWord) {
+
+   int iLength, c;
+
+   if (psLink->iBinary == 0) return scanf(" %15s", acWord) == 1;
+
+   iLength = 0;
+   for (;;) {
+      if (psLink->iLength == 0 && fillLink(psLink) == 0) break;
+      c = psLink->aucBuffer[psLink->iStart];
+      psLink->iStart++;
+      psLink->iLength--;
+      if (isspace(c) && iLength > 0) break;
+      if (isspace(c)) continue;
+      if (iLength < TOKEN_SIZE - 1) acWord[iLength++] = (char)c;
+   }
+   acWord[iLength] = '\0';
+   return iLength > 0;
+}
+
+/*--------------------------------------------------------------------*/
+/* Reads the other player's move from the referee through psLink, the
+   move numbered iSequence, and stores its row and column in *piRow and
+   *piColumn, -1 for a row that is not a number. A word that is not a
+   move, such as ENDGAME, is stored in acWord, and so is a move of the
+   text protocol. Returns READ_MOVE, READ_WORD or READ_EOF. */
+
+static int readMove(struct Link *psLink, int iSequence, int *piRow,
+                    int *piColumn, char *acWord) {
+
+   char columnChar;
+   int iSquare, iFlags, iNumber;
+
+   if (psLink->iBinary == 0) {
+      if (scanf(" %15s", acWord) != 1) return READ_EOF;
+      if (strcmp(acWord, "ENDGAME") == 0) return READ_WORD;
+      columnChar = ' ';
+      if (sscanf(acWord, "%c%d", &columnChar, piRow) != 2) *piRow = -1;
+      *piColumn = (int)(columnChar - 'A');
+      return READ_MOVE;
+   }
+
+   /* No square is a letter, so a word is told apart from a frame by
+      its first byte. */
+   if (psLink->iLength == 0 && fillLink(psLink) == 0) return READ_EOF;
+   if (psLink->aucBuffer[psLink->iStart] >= TILES)
+      return (readWord(psLink, acWord) == 1) ? READ_WORD : READ_EOF;
+   while (psLink->iLength < PROTOCOL_FRAME)
+      if (fillLink(psLink) == 0) return READ_EOF;
+   (void)Protocol_unpack(psLink->aucBuffer + psLink->iStart, &iSquare,
+                         &iFlags, &iNumber);
+   psLink->iStart += PROTOCOL_FRAME;
+   psLink->iLength -= PROTOCOL_FRAME;
+   *piRow = (iNumber == iSequence) ? iSquare / SIZE : -1;
+   *piColumn = iSquare % SIZE;
+   sprintf(acWord, "%c%d", (char)('A' + *piColumn), *piRow);
+   return READ_MOVE;
+}
+
+/*--------------------------------------------------------------------*/
+/* Sends the engine's move to row and column, the move numbered
+   iSequence, to the referee through psLink. Returns 1 if successful
+   and 0 if not. */
+
+static int writeMove(struct Link *psLink, int iSequence, int row,
+                     int column) {
+
+   unsigned char aucFrame[PROTOCOL_FRAME];
+   char acMove[TOKEN_SIZE];
+   int iLength;
+
+   if (psLink->iBinary == 1) {
+      Protocol_pack(aucFrame, row * SIZE + column, 0, iSequence);
+      return writeLink(psLink, aucFrame, sizeof(aucFrame));
+   }
+   iLength = sprintf(acMove, "%c%d\n", (char)('A' + column), row);
+   return writeLink(psLink, acMove, (size_t)iLength);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the number of milliseconds of wall clock time the engine
+   can spend on its next move on oBoard, given that it has used lUsed
+   of the game limit lGameMillis and that a move may take lMoveMillis
+   (0 for no limit): what is left of the game limit, shared evenly
+   between the moves it still has to make, but never more than the
+   move limit allows. */
+
+static long moveBudget(Board_T oBoard, long lUsed, long lMoveMillis,
+                       long lGameMillis) {
+
+   long lBudget, lLeft, lMargin;
+   int iEmpty;
+
+   lBudget = 0;
+   if (lGameMillis > 0) {
+      lMargin = lGameMillis / 20;
+      if (lMargin > TIME_MARGIN) lMargin = TIME_MARGIN;
+      lLeft = lGameMillis - lMargin - lUsed;
+      iEmpty = Bitboard_count(Board_getEmpty(oBoard));
+      lBudget = lLeft / ((iEmpty + 1) / 2 + 1);
+      if (lBudget < 1) lBudget = 1;
+   }
+   if (lMoveMillis > 0) {
+      /* Leave time for the move to reach the referee. */
+      lLeft = lMoveMillis - lMoveMillis / 10 - 5;
+      if (lLeft < 1) lLeft = 1;
+      if (lBudget == 0 || lLeft < lBudget) lBudget = lLeft;
+   }
+   if (lBudget == 0) lBudget = FREE_MILLIS;
+   return lBudget;
+}
+
+/*--------------------------------------------------------------------*/
+/* Finds a move for the current player on oBoard in about lBudget
+   milliseconds, with iThreads threads and the transposition table
+   oTT, and stores its row and column in *piRow and *piColumn. Plays
+   the move of the opening book oBook if there is one (oBook may be
+   NULL). Near the end of the game, plays perfectly if it can solve the
+   game in half the time, and searches with what is left if not. */
+
+static void chooseMove(Board_T oBoard, Book_T oBook, TT_T oTT,
+                       int iThreads, long lBudget, int *piRow,
+                       int *piColumn) {
+
+   struct Endgame_Result sResult;
+   long lStart;
+   int iEmpty, iScore;
+
+   if (oBook != NULL
+       && Book_find(oBook, oBoard, piRow, piColumn, &iScore) == 1)
+      return;
+
+   iEmpty = Bitboard_count(Board_getEmpty(oBoard));
+   if (iEmpty <= SOLVE_EMPTIES) {
+      lStart = Metrics_millis();
+      if (Endgame_solve(oBoard, (lBudget + 1) / 2, &sResult) == 1) {
+         *piRow = sResult.iRow;
+         *piColumn = sResult.iColumn;
+         return;
+      }
+      lBudget -= Metrics_millis() - lStart;
+      if (lBudget < 1) lBudget = 1;
+   }
+   (void)Search_bestMoveParallel(oBoard, oTT, MAX_DEPTH, lBudget,
+                                 iThreads, piRow, piColumn, NULL);
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays a game of othello against the referee as player me (1 or 2),
+   with the opening book oBook (or NULL), the transposition table oTT,
+   iThreads search threads and the time limits lMoveMillis and
+   lGameMillis. Reads the other player's moves and writes its own
+   through psLink, as a column letter followed by a row number or as
+   frames. pcName is the name of the engine for error messages. Returns
+   GAME_FINISHED if the game was played to the end, GAME_ENDED if the
+   referee ended it with ENDGAME, GAME_EOF if stdin or stdout closed
+   and GAME_INVALID if the other player's move is not valid. */
+
+static int playGame(struct Link *psLink, Book_T oBook, TT_T oTT,
+                    int iThreads, int me, long lMoveMillis,
+                    long lGameMillis, const char *pcName) {
+
+   struct Board_Storage sBoard;
+   Board_T oBoard;
+   int row, column, iResult, iRead, iSequence;
+   char acToken[TOKEN_SIZE];
+   long lStart, lUsed;
+
+   /* The referee's clock runs from the start of each turn. */
+   lUsed = 0;
+   lStart = Metrics_millis();
+
+   oBoard = Board_initIn(&sBoard, 0, NULL);
+   iResult = GAME_FINISHED;
+   iSequence = 0;
+   do {
+      if (Board_getPlayer(oBoard) == me) {
+         /* Find a move and send it to the referee. */
+         chooseMove(oBoard, oBook, oTT, iThreads,
+                    moveBudget(oBoard, lUsed, lMoveMillis, lGameMillis),
+                    &row, &column);
+         if (writeMove(psLink, iSequence, row, column) == 0) {
+            perror(pcName);
+            iResult = GAME_EOF;
+            break;
+         }
+         lUsed += Metrics_millis() - lStart;
+
+         /* After a pass the next turn is the engine's again. */
+         lStart = Metrics_millis();
+      }
+      else {
+         /* Read the other player's move. */
+         iRead = readMove(psLink, iSequence, &row, &column, acToken);
+         if (iRead == READ_EOF) {
+            iResult = GAME_EOF;
+            break;
+         }
+         if (iRead == READ_WORD && strcmp(acToken, "ENDGAME") == 0) {
+            iResult = GAME_ENDED;
+            break;
+         }
+         lStart = Metrics_millis();
+         if (iRead == READ_WORD
+             || Board_moveIsValid(oBoard, row, column) == 0) {
+            fprintf(stderr, "%s: invalid move %s\n", pcName, acToken);
+            iResult = GAME_INVALID;
+            break;
+         }
+      }
+      Board_makeMove(oBoard, row, column);
+      iSequence++;
+   } while (Board_draw(oBoard) != 0);
+
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays games of othello against the referee. argv[1] is the player
+   the engine is, FIRST or SECOND, for a single game, or POOL to play
+   one game after another as the referee starts them with NEWGAME
+   FIRST or NEWGAME SECOND and ends them with ENDGAME, keeping its
+   transposition table between them. If argv[2] is BINARY, accepts
+   the binary protocol of protocol.h. Evaluates with the weight file
+   named in OTHELLO_WEIGHTS and opens with the book named in
+   OTHELLO_BOOK if there are any, and searches with the number of
+   threads in OTHELLO_THREADS (0 for one per processor). argc is the
+   command line argument count. Returns 0, or EXIT_FAILURE if the
+   arguments or a move are not valid. */
+
+int main(int argc, char *argv[]) {
+
+   struct Link sLink;
+   TT_T oTT;
+   int me, iResult, iThreads;
+   char acCommand[TOKEN_SIZE];
+   char acRole[TOKEN_SIZE];
+   long lMoveMillis, lGameMillis;
+   char *pcWeights, *pcBook;
+   Book_T oBook;
+
+   if (argc < 2) {
+      fprintf(stderr, "Usage: %s FIRST|SECOND|POOL\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+   if (strcmp(argv[1], "FIRST") == 0) me = 1;
+   else if (strcmp(argv[1], "SECOND") == 0) me = 2;
+   else if (strcmp(argv[1], "POOL") == 0) me = 0;
+   else {
+      fprintf(stderr, "Usage: %s FIRST|SECOND|POOL\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   /* Accept the binary protocol before anything else. */
+   sLink.iBinary = (argc >= 3 && strcmp(argv[2], "BINARY") == 0);
+   sLink.iStart = 0;
+   sLink.iLength = 0;
+   if (sLink.iBinary == 1
+       && writeLink(&sLink, acProtocolHello, PROTOCOL_FRAME) == 0) {
+      perror(argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   lMoveMillis = getLimit("OTHELLO_MOVETIME", MOVE_MILLIS);
+   lGameMillis = getLimit("OTHELLO_GAMETIME", GAME_MILLIS);
+   iThreads = (int)getLimit("OTHELLO_THREADS", THREADS);
+   if (iThreads < 0) iThreads = THREADS;
+
+   /* Play on with the made up weights, or without a book, if their
+      files are no good. */
+   Eval_init();
+   pcWeights = getenv("OTHELLO_WEIGHTS");
+   if (pcWeights != NULL && pcWeights[0] != '\0'
+       && Eval_load(pcWeights) == 0)
+      fprintf(stderr, "%s: cannot load weights from %s\n", argv[0],
+              pcWeights);
+   oBook = NULL;
+   pcBook = getenv("OTHELLO_BOOK");
+   if (pcBook != NULL && pcBook[0] != '\0') {
+      oBook = Book_open(pcBook);
+      if (oBook == NULL)
+         fprintf(stderr, "%s: cannot open the book %s\n", argv[0],
+                 pcBook);
+   }
+   oTT = TT_new(TT_BYTES);
+
+   if (me != 0) {
+      iResult = playGame(&sLink, oBook, oTT, iThreads, me,
+                         lMoveMillis, lGameMillis, argv[0]);
+      TT_free(oTT);
+      if (oBook != NULL) Book_close(oBook);
+      return (iResult == GAME_INVALID) ? EXIT_FAILURE : 0;
+   }
+
+   /* Play games until the referee closes stdin. */
+   iResult = GAME_ENDED;
+   while (readWord(&sLink, acCommand) == 1
+          && readWord(&sLink, acRole) == 1
+          && strcmp(acCommand, "NEWGAME") == 0) {
+      me = (strcmp(acRole, "FIRST") == 0) ? 1 : 2;
+      iResult = playGame(&sLink, oBook, oTT, iThreads, me,
+                         lMoveMillis, lGameMillis, argv[0]);
+      if (iResult == GAME_FINISHED) {
+         if (readWord(&sLink, acCommand) == 0
+             || strcmp(acCommand, "ENDGAME") != 0)
+            break;
+         iResult = GAME_ENDED;
+      }
+      if (iResult != GAME_ENDED) break;
+      if (writeLink(&sLink, "ENDGAME\n", 8) == 0) break;
+   }
+   TT_free(oTT);
+   if (oBook != NULL) Book_close(oBook);
+   return (iResult == GAME_INVALID) ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,276 @@
+/*--------------------------------------------------------------------*/
+/* eval.c                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "eval.h"
+#include "bitboard.h"
+
+/* Number of tiles on the board. */
+enum {TILES = 64};
+
+/* Number of tiles of an edge, a corner and a diagonal pattern. */
+enum {EDGE_TILES = 8, CORNER_TILES = 9, DIAGONAL_TILES = 8};
+
+/* Number of masks of the tiles of a pattern: 2 to the power of the
+   tiles of the largest one. */
+enum {MASKS = 1 << CORNER_TILES};
+
+/* Score of every move of difference in mobility, unless a weight file
+   says otherwise. */
+enum {MOBILITY_SCORE = 10};
+
+/* The version of the weight file format. */
+enum {VERSION = 1};
+
+/* Number of weights in a weight file. */
+enum {WEIGHTS = EVAL_EDGE_SIZE + EVAL_CORNER_SIZE + EVAL_DIAGONAL_SIZE
+      + 1};
+
+/* The tiles of the long diagonal from A1 to H8. */
+#define LONG_DIAGONAL 0x8040201008040201ULL
+
+/* Every row of a bitboard, to gather the tiles of a diagonal into the
+   top one by multiplying. */
+#define ALL_ROWS 0x0101010101010101ULL
+
+/*--------------------------------------------------------------------*/
+
+/* How much each tile is worth to the player that owns it. Corners
+   are worth the most, the tiles next to them give corners away. Only
+   used to make up weights when there is no weight file. */
+static const int aiWeight[TILES] = {
+   100, -20,  10,   5,   5,  10, -20, 100,
+   -20, -50,  -2,  -2,  -2,  -2, -50, -20,
+    10,  -2,  -1,  -1,  -1,  -1,  -2,  10,
+     5,  -2,  -1,  -1,  -1,  -1,  -2,   5,
+     5,  -2,  -1,  -1,  -1,  -1,  -2,   5,
+    10,  -2,  -1,  -1,  -1,  -1,  -2,  10,
+   -20, -50,  -2,  -2,  -2,  -2, -50, -20,
+   100, -20,  10,   5,   5,  10, -20, 100
+};
+
+/* The first bytes of every weight file. */
+static const unsigned char aucMagic[4] = {'O', 'T', 'H', 'W'};
+
+/* The value of each mask of tiles as a base-3 number with a digit of
+   1 for each tile in it. A pattern index is the value of the player's
+   tiles plus twice that of the other player's. */
+static uint16_t auTernary[MASKS];
+
+/* The weights of the patterns, by index. */
+static int16_t aiEdge[EVAL_EDGE_SIZE];
+static int16_t aiCorner[EVAL_CORNER_SIZE];
+static int16_t aiDiagonal[EVAL_DIAGONAL_SIZE];
+
+/* Score of every move of difference in mobility. */
+static int iMobility;
+
+/*--------------------------------------------------------------------*/
+/* Fills auTernary. */
+
+static void fillTernary(void) {
+
+   int iMask, i, iPower;
+
+   for (iMask = 0; iMask < MASKS; iMask++) {
+      auTernary[iMask] = 0;
+      iPower = 1;
+      for (i = 0; i < CORNER_TILES; i++) {
+         if ((iMask & (1 << i)) != 0)
+            auTernary[iMask] = (uint16_t)(auTernary[iMask] + iPower);
+         iPower *= 3;
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Stores in piWeights the weights of the iSize indexes of a pattern
+   whose digit i lies on the tile piTiles[i], or on no tile of its own
+   if that is -1: the tile weights of the player's tiles of its own
+   less those of the other player's. */
+
+static void makeWeights(int16_t *piWeights, int iSize,
+                        const int *piTiles) {
+
+   int iIndex, iRest, iScore, i;
+
+   for (iIndex = 0; iIndex < iSize; iIndex++) {
+      iScore = 0;
+      iRest = iIndex;
+      for (i = 0; iRest > 0; i++) {
+         if (piTiles[i] != -1) {
+            if (iRest % 3 == 1) iScore += aiWeight[piTiles[i]];
+            else if (iRest % 3 == 2) iScore -= aiWeight[piTiles[i]];
+         }
+         iRest /= 3;
+      }
+      piWeights[iIndex] = (int16_t)iScore;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+void Eval_init(void) {
+
+   /* Each tile counts in only one pattern: the corners keep their 3
+      by 3 squares, the edges the two tiles between them and the
+      diagonals the two in the middle. The 16 tiles in no pattern
+      count for nothing. */
+   static const int aiEdgeTiles[EDGE_TILES] = {
+      -1, -1, -1, 3, 4, -1, -1, -1
+   };
+   static const int aiCornerTiles[CORNER_TILES] = {
+      0, 1, 2, 8, 9, 10, 16, 17, 18
+   };
+   static const int aiDiagonalTiles[DIAGONAL_TILES] = {
+      -1, -1, -1, 27, 36, -1, -1, -1
+   };
+
+   fillTernary();
+   makeWeights(aiEdge, EVAL_EDGE_SIZE, aiEdgeTiles);
+   makeWeights(aiCorner, EVAL_CORNER_SIZE, aiCornerTiles);
+   makeWeights(aiDiagonal, EVAL_DIAGONAL_SIZE, aiDiagonalTiles);
+   iMobility = MOBILITY_SCORE;
+}
+
+/*--------------------------------------------------------------------*/
+int Eval_load(const char *pcFile) {
+
+   FILE *psFile;
+   unsigned char aucHeader[sizeof(aucMagic) + 1];
+   unsigned char *pucWeights;
+   int16_t *piWeights;
+   int i, iOk;
+
+   psFile = fopen(pcFile, "rb");
+   if (psFile == NULL) return 0;
+   pucWeights = malloc((size_t)WEIGHTS * 2);
+   piWeights = malloc((size_t)WEIGHTS * sizeof(int16_t));
+   iOk = (pucWeights != NULL && piWeights != NULL
+          && fread(aucHeader, 1, sizeof(aucHeader), psFile)
+             == sizeof(aucHeader)
+          && memcmp(aucHeader, aucMagic, sizeof(aucMagic)) == 0
+          && aucHeader[sizeof(aucMagic)] == VERSION
+          && fread(pucWeights, 2, WEIGHTS, psFile) == WEIGHTS
+          && getc(psFile) == EOF);
+   fclose(psFile);
+
+   /* Only take the weights once the whole file is known to be good. */
+   if (iOk == 1) {
+      for (i = 0; i < WEIGHTS; i++)
+         piWeights[i] = (int16_t)(uint16_t)(pucWeights[2 * i]
+                                            | pucWeights[2 * i + 1] << 8);
+      fillTernary();
+      memcpy(aiEdge, piWeights, sizeof(aiEdge));
+      memcpy(aiCorner, piWeights + EVAL_EDGE_SIZE, sizeof(aiCorner));
+      memcpy(aiDiagonal, piWeights + EVAL_EDGE_SIZE + EVAL_CORNER_SIZE,
+             sizeof(aiDiagonal));
+      iMobility = piWeights[WEIGHTS - 1];
+   }
+   free(piWeights);
+   free(pucWeights);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+int Eval_save(const char *pcFile) {
+
+   FILE *psFile;
+   unsigned char *pucWeights;
+   int iWeight, i, iOk;
+
+   pucWeights = malloc((size_t)WEIGHTS * 2);
+   if (pucWeights == NULL) return 0;
+   for (i = 0; i < WEIGHTS; i++) {
+      if (i < EVAL_EDGE_SIZE) iWeight = aiEdge[i];
+      else if (i < EVAL_EDGE_SIZE + EVAL_CORNER_SIZE)
+         iWeight = aiCorner[i - EVAL_EDGE_SIZE];
+      else if (i < WEIGHTS - 1)
+         iWeight = aiDiagonal[i - EVAL_EDGE_SIZE - EVAL_CORNER_SIZE];
+      else iWeight = iMobility;
+      pucWeights[2 * i] = (unsigned char)((unsigned)iWeight & 0xFF);
+      pucWeights[2 * i + 1] = (unsigned char)(((unsigned)iWeight >> 8)
+                                              & 0xFF);
+   }
+
+   psFile = fopen(pcFile, "wb");
+   iOk = (psFile != NULL
+          && fwrite(aucMagic, 1, sizeof(aucMagic), psFile)
+             == sizeof(aucMagic)
+          && putc(VERSION, psFile) != EOF
+          && fwrite(pucWeights, 2, WEIGHTS, psFile) == WEIGHTS);
+   if (psFile != NULL && fclose(psFile) != 0) iOk = 0;
+   free(pucWeights);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the mask of the tiles of u in its 3 by 3 corner at A1, row
+   by row. */
+
+static unsigned cornerMask(uint64_t u) {
+   return (unsigned)((u & 0x7) | ((u >> 5) & 0x38) | ((u >> 10) & 0x1C0));
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the mask of the tiles of u on its long diagonal from A1 to
+   H8. */
+
+static unsigned diagonalMask(uint64_t u) {
+   return (unsigned)(((u & LONG_DIAGONAL) * ALL_ROWS) >> 56);
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the index of the pattern whose tiles of the player are
+   uOwnMask and of the other player uOppMask. */
+
+static int patternIndex(unsigned uOwnMask, unsigned uOppMask) {
+   return auTernary[uOwnMask] + 2 * auTernary[uOppMask];
+}
+
+/*--------------------------------------------------------------------*/
+int Eval_evaluate(uint64_t uOwn, uint64_t uOpp) {
+   return Eval_evaluateMoves(uOwn, uOpp,
+                             Bitboard_legalMoves(uOwn, uOpp),
+                             Bitboard_legalMoves(uOpp, uOwn));
+}
+
+/*--------------------------------------------------------------------*/
+int Eval_evaluateMoves(uint64_t uOwn, uint64_t uOpp, uint64_t uOwnMoves,
+                       uint64_t uOppMoves) {
+
+   uint64_t uOwnH, uOppH, uOwnT, uOppT;
+   int iScore;
+
+   /* Each copy of a pattern is read at the A1 corner, the first row or
+      the long diagonal of a mirrored, flipped or transposed board. */
+   uOwnH = Bitboard_mirror(uOwn);
+   uOppH = Bitboard_mirror(uOpp);
+   uOwnT = Bitboard_transpose(uOwn);
+   uOppT = Bitboard_transpose(uOpp);
+
+   iScore = aiEdge[patternIndex(uOwn & 0xFF, uOpp & 0xFF)]
+      + aiEdge[patternIndex(uOwn >> 56, uOpp >> 56)]
+      + aiEdge[patternIndex(uOwnT & 0xFF, uOppT & 0xFF)]
+      + aiEdge[patternIndex(uOwnT >> 56, uOppT >> 56)];
+
+   iScore += aiCorner[patternIndex(cornerMask(uOwn), cornerMask(uOpp))]
+      + aiCorner[patternIndex(cornerMask(uOwnH), cornerMask(uOppH))]
+      + aiCorner[patternIndex(cornerMask(Bitboard_flip(uOwn)),
+                              cornerMask(Bitboard_flip(uOpp)))]
+      + aiCorner[patternIndex(cornerMask(Bitboard_flip(uOwnH)),
+                              cornerMask(Bitboard_flip(uOppH)))];
+
+   iScore += aiDiagonal[patternIndex(diagonalMask(uOwn),
+                                     diagonalMask(uOpp))]
+      + aiDiagonal[patternIndex(diagonalMask(uOwnH),
+                                diagonalMask(uOppH))];
+
+   return iScore
+      + iMobility * (Bitboard_count(uOwnMoves)
+                     - Bitboard_count(uOppMoves));
+}
+/*--------------------------------------------------------------------*/
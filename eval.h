@@ -0,0 +1,54 @@
+/*--------------------------------------------------------------------*/
+/* eval.h                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef EVAL_INCLUDED
+#define EVAL_INCLUDED
+
+#include <stdint.h>
+
+/* The static evaluation scores a position without searching it. The
+   board is cut into patterns: the four edges, the four 3 by 3
+   corners and the two long diagonals. The tiles of each pattern are
+   read straight off the bitboards as an index into a table of
+   weights, one table per kind of pattern shared by its symmetric
+   copies, and the difference in mobility is added. The weights are
+   loaded from a weight file, or made up from a table of tile weights
+   if there is none. A weight file is "OTHW", a version byte of 1 and
+   then each table as signed 16-bit weights, least significant byte
+   first: EVAL_EDGE_SIZE edge weights, EVAL_CORNER_SIZE corner
+   weights, EVAL_DIAGONAL_SIZE diagonal weights and the mobility
+   weight. Pattern indexes count the tiles of the pattern as base-3
+   digits, the first tile lowest: 0 for empty, 1 for the player to
+   move and 2 for the other player. */
+
+/* Numbers of weights of the patterns: 3 to the power of their tiles. */
+enum {EVAL_EDGE_SIZE = 6561, EVAL_CORNER_SIZE = 19683,
+      EVAL_DIAGONAL_SIZE = 6561};
+
+/* Sets the weights up from the table of tile weights. Must be called,
+   or Eval_load, before the first Eval_evaluate and not while it
+   runs. */
+void Eval_init(void);
+
+/* Loads the weights from the weight file pcFile, as Eval_init sets
+   them up. Returns 1 if successful, or 0 if the file cannot be read
+   or is not a weight file, when the weights are left as they were. */
+int Eval_load(const char *pcFile);
+
+/* Writes the weights to the weight file pcFile. Returns 1 if
+   successful and 0 if not. */
+int Eval_save(const char *pcFile);
+
+/* Returns the static evaluation of the position where the player to
+   move has the tiles uOwn and the other player the tiles uOpp, for the
+   player to move. */
+int Eval_evaluate(uint64_t uOwn, uint64_t uOpp);
+
+/* Returns what Eval_evaluate does, given the moves uOwnMoves of the
+   player to move and uOppMoves of the other player as well, for a
+   caller that already has them (see Board_getMoves). */
+int Eval_evaluateMoves(uint64_t uOwn, uint64_t uOpp, uint64_t uOwnMoves,
+                       uint64_t uOppMoves);
+
+#endif
@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------*/
+/* game.c                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#include "board.h"
+#include "game.h"
+#include "match.h"
+#include "metrics.h"
+#include "mux.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Longest start of a line of metrics, including the null character. */
+enum {PREFIX_SIZE = 2 * RECORD_MAX_NAME};
+
+/* The one game played by Game_play. */
+struct Game {
+   /* The arguments of Game_play. */
+   char *player1;
+   char *player2;
+   int tracking;
+   FILE *psFile;
+   long lMoveMillis;
+   long lGameMillis;
+   int iBinary;
+   Record_T oRecord;
+   FILE *psMetrics;
+
+   /* Whether the game has been started, and whether it was played. */
+   int iStarted;
+   int iPlayed;
+
+   /* The score of the game. */
+   int iScore;
+};
+
+/*--------------------------------------------------------------------*/
+/* Starts the game pvGame, a struct Game, the first time it is called
+   and stores its match in *poMatch. Returns 0 after that. */
+
+static int startGame(void *pvGame, Match_T *poMatch, void **ppvGame) {
+
+   struct Game *psGame = pvGame;
+
+   if (psGame->iStarted == 1) return 0;
+   psGame->iStarted = 1;
+   *poMatch = Match_new(psGame->player1, psGame->player2,
+                        psGame->tracking, psGame->psFile,
+                        psGame->lMoveMillis, psGame->lGameMillis,
+                        psGame->iBinary, NULL, psGame->oRecord);
+   *ppvGame = psGame;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the latency histograms of oMatch, the match of the game
+   psGame, to its metrics file, and then those of each player, which
+   are the same but for a player that played itself. */
+
+static void writeMetrics(struct Game *psGame, Match_T oMatch) {
+
+   struct Metrics_Histogram sThink, sReferee;
+   char acPrefix[PREFIX_SIZE];
+   int player, iPlayers;
+
+   Match_writeMetrics(oMatch, 1, psGame->psMetrics);
+   iPlayers = (strcmp(psGame->player1, psGame->player2) == 0) ? 1 : 2;
+   for (player = 1; player <= iPlayers; player++) {
+      memset(&sThink, 0, sizeof(sThink));
+      memset(&sReferee, 0, sizeof(sReferee));
+      Metrics_merge(&sThink, Match_getThinkTimes(oMatch, player));
+      Metrics_merge(&sReferee, Match_getRefereeTimes(oMatch, player));
+      if (iPlayers == 1) {
+         Metrics_merge(&sThink, Match_getThinkTimes(oMatch, 2));
+         Metrics_merge(&sReferee, Match_getRefereeTimes(oMatch, 2));
+      }
+      snprintf(acPrefix, sizeof(acPrefix),
+               "summary player=%s games=1 kind=think ",
+               (player == 1) ? psGame->player1 : psGame->player2);
+      Metrics_write(psGame->psMetrics, acPrefix, &sThink);
+      snprintf(acPrefix, sizeof(acPrefix),
+               "summary player=%s games=1 kind=referee ",
+               (player == 1) ? psGame->player1 : psGame->player2);
+      Metrics_write(psGame->psMetrics, acPrefix, &sReferee);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Stores the result of oMatch, the match of the game pvGame, and
+   writes its metrics if it has a metrics file. */
+
+static void finishGame(void *pvGame, void *pvUnused, Match_T oMatch) {
+
+   struct Game *psGame = pvGame;
+
+   (void)pvUnused;
+   if (oMatch == NULL) return;
+   psGame->iPlayed = 1;
+   psGame->iScore = Match_getScore(oMatch);
+   if (psGame->psMetrics != NULL) writeMetrics(psGame, oMatch);
+}
+
+/*--------------------------------------------------------------------*/
+int Game_checkPlayer(const char *player) {
+
+   assert(player != NULL);
+
+   if (access(player, X_OK) == -1) {
+      fprintf(stderr, "File %s does not exist or is not executable\n",
+              player);
+      return 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+int Game_play(char *player1, char *player2, int tracking, FILE *psFile,
+              long lMoveMillis, long lGameMillis, int iBinary,
+              Record_T oRecord, FILE *psMetrics, int *piScore) {
+
+   struct Game sGame;
+
+   assert(player1 != NULL);
+   assert(player2 != NULL);
+   assert(piScore != NULL);
+
+   sGame.player1 = player1;
+   sGame.player2 = player2;
+   sGame.tracking = tracking;
+   sGame.psFile = psFile;
+   sGame.lMoveMillis = lMoveMillis;
+   sGame.lGameMillis = lGameMillis;
+   sGame.iBinary = iBinary;
+   sGame.oRecord = oRecord;
+   sGame.psMetrics = psMetrics;
+   sGame.iStarted = 0;
+   sGame.iPlayed = 0;
+   sGame.iScore = 0;
+
+   /* A player that crashes loses the game instead of taking the
+      referee down with it when its moves are written. */
+   signal(SIGPIPE, SIG_IGN);
+   Mux_run(1, startGame, finishGame, &sGame);
+
+   if (sGame.iPlayed == 0) {
+      if (tracking == 1) fclose(psFile);
+      return 0;
+   }
+   *piScore = sGame.iScore;
+   return 1;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,33 @@
+/*--------------------------------------------------------------------*/
+/* game.h                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef GAME_INCLUDED
+#define GAME_INCLUDED
+
+#include <stdio.h>
+#include "record.h"
+
+/* Checks that the player file player exists and is executable. Prints
+   an error and returns 0 if not, returns 1 if it is. */
+int Game_checkPlayer(const char *player);
+
+/* Plays a game of othello between the player files player1 (FIRST)
+   and player2 (SECOND) in the current directory, each run as a child
+   process that reads the other's moves on stdin and writes its own on
+   stdout. If tracking is 1 the game is written to psFile, which is
+   closed at the end. A player loses if it takes longer than
+   lMoveMillis milliseconds for a move or lGameMillis for all of its
+   moves (0 for no limit). iBinary tells which players are offered the
+   binary protocol, as for Match_new. The record of the game is appended to
+   oRecord unless it is NULL. The latency histograms of the game are
+   written to psMetrics unless it is NULL (see Match_writeMetrics),
+   followed by a summary line of each kind for each player that starts
+   with "summary". Stores the score, i.e. FIRST's tiles minus SECOND's,
+   in *piScore. Returns 1 if the game was played and 0 if the players
+   could not be started. Safe to call from several threads at once. */
+int Game_play(char *player1, char *player2, int tracking, FILE *psFile,
+              long lMoveMillis, long lGameMillis, int iBinary,
+              Record_T oRecord, FILE *psMetrics, int *piScore);
+
+#endif
@@ -0,0 +1,763 @@
+/*--------------------------------------------------------------------*/
+/* match.c                                                            */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#define _GNU_SOURCE 1 /* for CLOCK_MONOTONIC */
+#include <errno.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/timerfd.h>
+#include "board.h"
+#include "match.h"
+#include "metrics.h"
+#include "player.h"
+#include "pool.h"
+#include "protocol.h"
+#include "record.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Longest start of a line of metrics, including the null character. */
+enum {PREFIX_SIZE = 2 * RECORD_MAX_NAME};
+
+/* Size of the "./" that is appended to player names (including null
+   character. */
+enum {SIZE_OF_DOTSLASH = 3};
+
+/* Number of bytes of a player's output that are held at a time. A
+   move is a letter and a number, so this is plenty. */
+enum {BUFFER_SIZE = 64};
+
+/* Longest move written to a player, including the null character. */
+enum {MOVE_SIZE = 16};
+
+/* The line a pooled player ends every game with. A player that speaks
+   the binary protocol has to end it with a newline, so that the
+   newline is not taken for a move. */
+static const char acEndGame[] = "ENDGAME\n";
+
+/* What parseMove() can find in the output of a player. */
+enum {MOVE_WAIT, MOVE_READ, MOVE_BAD, MOVE_EOF};
+
+/*--------------------------------------------------------------------*/
+
+/* A player file running as a child process. */
+struct Player {
+   /* The child. The pipe its moves are read from is non-blocking. */
+   struct Pool_Process sProcess;
+
+   /* Whether the child came from, and goes back to, a Pool. */
+   int iPooled;
+
+   /* Output of the child that has been read but not yet used. */
+   char acBuffer[BUFFER_SIZE];
+   int iLength;
+
+   /* Whether the child has closed its stdout. */
+   int iEof;
+};
+
+struct Match {
+   /* The players, FIRST then SECOND. */
+   struct Player asPlayers[2];
+
+   /* The names of the players. */
+   char *player1;
+   char *player2;
+
+   /* The Pool the pooled players come from, or NULL. */
+   Pool_T oPool;
+
+   /* The player that lost by crashing, running out of time or making
+      a bad move, or 0. */
+   int iLoser;
+
+   /* The file the record of the game is written to, or NULL, and the
+      record so far. */
+   Record_T oRecord;
+   struct Record_Game sRecord;
+
+   /* The board of the game, or NULL once the game is over, and the
+      memory it is kept in. */
+   Board_T oBoard;
+   struct Board_Storage sBoard;
+
+   /* Whether tracking is on, and the file written to if it is. */
+   int tracking;
+   FILE *psFile;
+
+   /* The number of moves made. */
+   int count;
+
+   /* Whether the game is over, and its score if so. */
+   int iOver;
+   int iScore;
+
+   /* The longest a player may take for one move and for all of its
+      moves, in milliseconds, or 0 for no limit. */
+   long lMoveMillis;
+   long lGameMillis;
+
+   /* The milliseconds of lGameMillis each player has left. */
+   long alLeft[2];
+
+   /* When the current player's turn started and when it has to have
+      moved by, in milliseconds of the monotonic clock. lDeadline is 0
+      if there is no limit. */
+   long lTurnStart;
+   long lDeadline;
+
+   /* A timer that becomes readable at lDeadline, or -1 if the game has
+      no time limit. */
+   int iTimer;
+
+   /* When the current player could start thinking about its move, in
+      nanoseconds of the monotonic clock: when the other player's move
+      was written to it, or when its turn started if there was none.
+      iSentTo is the player the last move was written to, or 0. */
+   uint64_t uThinkStart;
+   uint64_t uSent;
+   int iSentTo;
+
+   /* How long each player took for its moves, and how long the
+      referee took to check and play them. */
+   struct Metrics_Histogram asThink[2];
+   struct Metrics_Histogram asReferee[2];
+};
+
+/*--------------------------------------------------------------------*/
+/* Starts the player file player as a child process, passing it role
+   ("FIRST", "SECOND" or "POOL") as its argument, followed by "BINARY"
+   if iBinary is 1 to offer it the binary protocol, and stores it in
+   psProcess (see Player_spawn). Returns 1 if successful and 0 if
+   not. */
+
+static int startPlayer(const char *player, char *role, int iBinary,
+                       struct Pool_Process *psProcess) {
+
+   char *apcArgv[4];
+   char *exec;
+   int iOk;
+
+   /* Append a "./" to the player name to run the file. */
+   exec = calloc(strlen(player) + SIZE_OF_DOTSLASH, 1);
+   if (exec == NULL) return 0;
+   strcpy(exec, "./");
+   strcat(exec, player);
+
+   apcArgv[0] = exec;
+   apcArgv[1] = role;
+   apcArgv[2] = (iBinary == 1) ? "BINARY" : NULL;
+   apcArgv[3] = NULL;
+   iOk = Player_spawn(exec, apcArgv, &psProcess->iPid,
+                      &psProcess->iToChild, &psProcess->iFromChild);
+   free(exec);
+   if (iOk == 0) return 0;
+
+   /* Only this process uses the ends it keeps, so making them
+      non-blocking does not affect the child. */
+   psProcess->iPending = 0;
+   psProcess->iBinary = iBinary;
+   psProcess->iHello = 0;
+   fcntl(psProcess->iFromChild, F_SETFL, O_NONBLOCK);
+   fcntl(psProcess->iToChild, F_SETFL, O_NONBLOCK);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Reads the output of psPlayer that is waiting in its pipe, as much
+   as fits in its buffer. */
+
+static void fillBuffer(struct Player *psPlayer) {
+
+   ssize_t lRead;
+
+   while (psPlayer->iLength < BUFFER_SIZE && psPlayer->iEof == 0) {
+      lRead = read(psPlayer->sProcess.iFromChild,
+                   psPlayer->acBuffer + psPlayer->iLength,
+                   (size_t)(BUFFER_SIZE - psPlayer->iLength));
+      if (lRead > 0) psPlayer->iLength += (int)lRead;
+      else if (lRead == 0) psPlayer->iEof = 1;
+      else if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+      else if (errno != EINTR) psPlayer->iEof = 1;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Throws away the output of the pooled player psPlayer up to and
+   including the ENDGAME lines it still owes for earlier games. Returns
+   1 once they have all arrived and 0 if more output is needed. */
+
+static int skipEndGames(struct Player *psPlayer) {
+
+   char *pcBuffer = psPlayer->acBuffer;
+   char *pcFound;
+   int iKeep, iFull, iEndGame;
+
+   /* Text players may leave out the newline. */
+   iEndGame = (int)strlen(acEndGame);
+   if (psPlayer->sProcess.iBinary == 0) iEndGame--;
+   while (psPlayer->sProcess.iPending > 0) {
+      fillBuffer(psPlayer);
+      iFull = (psPlayer->iLength == BUFFER_SIZE);
+      pcFound = NULL;
+      if (psPlayer->iLength > 0) {
+         /* The buffer is not null-terminated, so search it as bytes. */
+         for (iKeep = 0; iKeep + iEndGame <= psPlayer->iLength;
+              iKeep++) {
+            if (memcmp(pcBuffer + iKeep, acEndGame, (size_t)iEndGame)
+                == 0) {
+               pcFound = pcBuffer + iKeep;
+               break;
+            }
+         }
+      }
+      if (pcFound == NULL) {
+         /* Keep what could be the start of an ENDGAME. */
+         iKeep = iEndGame - 1;
+         if (psPlayer->iLength > iKeep) {
+            memmove(pcBuffer, pcBuffer + psPlayer->iLength - iKeep,
+                    (size_t)iKeep);
+            psPlayer->iLength = iKeep;
+         }
+         if (psPlayer->iEof == 1) {
+            /* Let parseMove find the crash. */
+            psPlayer->iLength = 0;
+            return 1;
+         }
+         if (iFull == 0) return 0;
+         continue;
+      }
+      iKeep = (int)(pcFound - pcBuffer) + iEndGame;
+      memmove(pcBuffer, pcBuffer + iKeep,
+              (size_t)(psPlayer->iLength - iKeep));
+      psPlayer->iLength -= iKeep;
+      psPlayer->sProcess.iPending--;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Looks for a move in the output of psPlayer, read the way fscanf
+   reads " %c%d": white space, a column letter, white space and a row
+   number. Stores the column in *pcColumn and the row in *piRow, or -1
+   if there is no row. Returns MOVE_READ and removes the move from the
+   buffer if there is one, MOVE_WAIT if more output is needed,
+   MOVE_BAD if the output is not a move and MOVE_EOF if the player
+   closed its stdout before starting one. */
+
+static int parseMove(struct Player *psPlayer, char *pcColumn,
+                     int *piRow) {
+
+   char *pcBuffer = psPlayer->acBuffer;
+   int i, iStart, iSign, iDigits;
+   long lRow;
+
+   *piRow = -1;
+
+   /* Throw away the white space before the move. */
+   for (i = 0; i < psPlayer->iLength
+           && isspace((unsigned char)pcBuffer[i]); i++);
+   memmove(pcBuffer, pcBuffer + i, (size_t)(psPlayer->iLength - i));
+   psPlayer->iLength -= i;
+   if (psPlayer->iLength == 0)
+      return (psPlayer->iEof == 1) ? MOVE_EOF : MOVE_WAIT;
+
+   /* The column, then the row after any white space. */
+   *pcColumn = pcBuffer[0];
+   for (i = 1; i < psPlayer->iLength
+           && isspace((unsigned char)pcBuffer[i]); i++);
+   iStart = i;
+   iSign = 1;
+   if (i < psPlayer->iLength && (pcBuffer[i] == '-'
+                                 || pcBuffer[i] == '+')) {
+      if (pcBuffer[i] == '-') iSign = -1;
+      i++;
+   }
+   lRow = 0;
+   for (iDigits = 0; i < psPlayer->iLength
+           && isdigit((unsigned char)pcBuffer[i]); i++, iDigits++) {
+      if (lRow < 1000000) lRow = 10 * lRow + (pcBuffer[i] - '0');
+   }
+
+   /* The number ends at the first character that is not a digit. */
+   if (i == psPlayer->iLength && psPlayer->iEof == 0) {
+      if (psPlayer->iLength == BUFFER_SIZE) return MOVE_BAD;
+      return MOVE_WAIT;
+   }
+   if (iDigits == 0 || i == iStart) return MOVE_BAD;
+
+   *piRow = (int)(iSign * lRow);
+   memmove(pcBuffer, pcBuffer + i, (size_t)(psPlayer->iLength - i));
+   psPlayer->iLength -= i;
+   return MOVE_READ;
+}
+
+/*--------------------------------------------------------------------*/
+/* Looks for a move in the output of psPlayer, which speaks the binary
+   protocol of protocol.h, after its hello if that has not been read
+   yet. The move must have the sequence number iSequence. Stores its
+   column letter in *pcColumn and its row in *piRow. Returns what
+   parseMove() returns, MOVE_BAD if the player did not accept the
+   protocol or the frame is not a move of iSequence. */
+
+static int parseFrame(struct Player *psPlayer, int iSequence,
+                      char *pcColumn, int *piRow) {
+
+   unsigned char *pucFrame = (unsigned char *)psPlayer->acBuffer;
+   int iSquare, iFlags, iNumber, iMove;
+
+   *piRow = -1;
+   while (psPlayer->iLength >= PROTOCOL_FRAME) {
+      iMove = Protocol_unpack(pucFrame, &iSquare, &iFlags, &iNumber);
+      if (psPlayer->sProcess.iHello == 0
+          && Protocol_isHello(pucFrame) == 0)
+         return MOVE_BAD;
+      memmove(pucFrame, pucFrame + PROTOCOL_FRAME,
+              (size_t)(psPlayer->iLength - PROTOCOL_FRAME));
+      psPlayer->iLength -= PROTOCOL_FRAME;
+      if (psPlayer->sProcess.iHello == 0) {
+         psPlayer->sProcess.iHello = 1;
+         continue;
+      }
+
+      /* A player never passes: it is passed over. */
+      if (iMove == 0) return MOVE_BAD;
+      *pcColumn = (char)('A' + iSquare % 8);
+      *piRow = iSquare / 8;
+      if (iFlags != 0 || iNumber != iSequence) return MOVE_BAD;
+      return MOVE_READ;
+   }
+   if (psPlayer->iEof == 0) return MOVE_WAIT;
+   return (psPlayer->iLength == 0) ? MOVE_EOF : MOVE_BAD;
+}
+
+/*--------------------------------------------------------------------*/
+/* Looks for the next move of psPlayer in the protocol it speaks, move
+   number iSequence of the game, reading what is waiting in its pipe
+   if there is not a whole move yet. Stores its column letter in
+   *pcColumn and its row in *piRow. Returns what parseMove() returns. */
+
+static int readMove(struct Player *psPlayer, int iSequence,
+                    char *pcColumn, int *piRow) {
+
+   int iRet, iTry;
+
+   for (iTry = 0; iTry < 2; iTry++) {
+      if (iTry == 1) fillBuffer(psPlayer);
+      if (psPlayer->sProcess.iBinary == 1)
+         iRet = parseFrame(psPlayer, iSequence, pcColumn, piRow);
+      else iRet = parseMove(psPlayer, pcColumn, piRow);
+      if (iRet != MOVE_WAIT) return iRet;
+   }
+   return MOVE_WAIT;
+}
+
+/*--------------------------------------------------------------------*/
+/* Starts the turn of the current player of oMatch: works out when it
+   has to move by, from whichever of its move and game limits runs out
+   first, and sets the timer of oMatch to go off then. */
+
+static void startTurn(Match_T oMatch) {
+
+   struct itimerspec sTimer;
+   long lLimit, lFire;
+   int player;
+
+   oMatch->lTurnStart = Metrics_millis();
+   player = Board_getPlayer(oMatch->oBoard);
+   oMatch->uThinkStart = (player == oMatch->iSentTo) ? oMatch->uSent
+      : Metrics_now();
+   if (oMatch->iTimer == -1) return;
+
+   lLimit = oMatch->lMoveMillis;
+   if (oMatch->lGameMillis > 0
+       && (lLimit == 0 || oMatch->alLeft[player - 1] < lLimit))
+      lLimit = oMatch->alLeft[player - 1];
+   if (lLimit < 0) lLimit = 0;
+   oMatch->lDeadline = oMatch->lTurnStart + lLimit;
+
+   /* A zero it_value would disarm the timer, so go off 1 ms later
+      rather than never. */
+   lFire = oMatch->lDeadline + (lLimit == 0 ? 1 : 0);
+   memset(&sTimer, 0, sizeof(sTimer));
+   sTimer.it_value.tv_sec = lFire / 1000;
+   sTimer.it_value.tv_nsec = (lFire % 1000) * 1000000;
+   timerfd_settime(oMatch->iTimer, TFD_TIMER_ABSTIME, &sTimer, NULL);
+}
+
+/*--------------------------------------------------------------------*/
+/* Charges the time since the current player of oMatch started its
+   turn to its clock. Returns 0 if it moved too late and 1 if not. */
+
+static int endTurn(Match_T oMatch) {
+
+   long lNow;
+
+   lNow = Metrics_millis();
+   if (oMatch->lDeadline != 0 && lNow > oMatch->lDeadline) return 0;
+   oMatch->alLeft[Board_getPlayer(oMatch->oBoard) - 1]
+      -= lNow - oMatch->lTurnStart;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the record of the game of oMatch, which is over, to its
+   record file if it has one. */
+
+static void writeRecord(Match_T oMatch) {
+   if (oMatch->oRecord == NULL) return;
+   oMatch->sRecord.iScore = oMatch->iScore;
+   (void)Record_write(oMatch->oRecord, &oMatch->sRecord);
+}
+
+/*--------------------------------------------------------------------*/
+/* Ends the game of oMatch badly, given crash, which is 1 if the
+   current player crashed, 2 if it ran out of time and 0 if it made an
+   invalid move. */
+
+static void endBadly(Match_T oMatch, int crash) {
+   oMatch->iLoser = Board_getPlayer(oMatch->oBoard);
+   oMatch->iScore = Board_endGameBad(oMatch->oBoard, oMatch->player1,
+                                     oMatch->player2, crash);
+   oMatch->oBoard = NULL;
+   oMatch->iOver = 1;
+   if (crash == 1) oMatch->sRecord.iEnd = RECORD_CRASHED;
+   else if (crash == 2) oMatch->sRecord.iEnd = RECORD_TIMED_OUT;
+   else oMatch->sRecord.iEnd = RECORD_BAD_MOVE;
+   writeRecord(oMatch);
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays the moves of oMatch that have arrived, until the game is over
+   or the current player has not sent its next move yet. */
+
+static void playMoves(Match_T oMatch) {
+
+   struct Player *psMover, *psOther;
+   char acMove[MOVE_SIZE];
+   unsigned char aucFrame[PROTOCOL_FRAME];
+   char columnChar;
+   int column, row, iRet, iLength, player;
+   uint64_t uStart, uChecked;
+
+   while (oMatch->iOver == 0) {
+      psMover = &oMatch->asPlayers[Board_getPlayer(oMatch->oBoard) - 1];
+
+      /* The current player's move. Some of it may still be in the
+         pipe, after the end of the last game if it is pooled. End the
+         game if the player crashed. */
+      if (skipEndGames(psMover) == 0) return;
+      columnChar = ' ';
+      iRet = readMove(psMover, oMatch->count, &columnChar, &row);
+      if (iRet == MOVE_WAIT) return;
+      if (iRet == MOVE_EOF) {
+         endBadly(oMatch, 1);
+         return;
+      }
+      player = Board_getPlayer(oMatch->oBoard);
+      uStart = Metrics_now();
+      Metrics_add(&oMatch->asThink[player - 1],
+                  uStart - oMatch->uThinkStart);
+      if (endTurn(oMatch) == 0) {
+         endBadly(oMatch, 2);
+         return;
+      }
+
+      /* Convert the column to an int. */
+      column = (int)(columnChar - 'A');
+      if (oMatch->tracking == 1)
+         Record_printMove(oMatch->oBoard, row, columnChar, oMatch->count,
+                          oMatch->psFile);
+
+      /* End the game is the move is not valid. */
+      uStart = Metrics_now();
+      if (iRet == MOVE_BAD
+          || Board_moveIsValid(oMatch->oBoard, row, column) == 0) {
+         oMatch->sRecord.cBadColumn = columnChar;
+         oMatch->sRecord.iBadRow = row;
+         endBadly(oMatch, 0);
+         return;
+      }
+
+      /* Send the move to the other player. If the other player has
+         crashed, that is found out when it is its turn. A game never
+         writes enough to fill the pipe. A frame is sent once the move
+         is made, as it tells whether the other player has to pass
+         next. */
+      uChecked = Metrics_now() - uStart;
+      psOther = &oMatch->asPlayers[2 - player];
+      if (psOther->sProcess.iBinary == 0) {
+         iLength = sprintf(acMove, "%c%d\n", columnChar, row);
+         (void)write(psOther->sProcess.iToChild, acMove,
+                     (size_t)iLength);
+         oMatch->uSent = Metrics_now();
+         oMatch->iSentTo = 3 - player;
+      }
+
+      uStart = Metrics_now();
+      Board_makeMove(oMatch->oBoard, row, column); /* Make the move. */
+
+      /* Draw the board after the move is made. */
+      if (oMatch->tracking == 1)
+         iRet = Record_printDraw(oMatch->oBoard, oMatch->psFile);
+      else iRet = Board_draw(oMatch->oBoard);
+      Metrics_add(&oMatch->asReferee[player - 1],
+                  uChecked + (Metrics_now() - uStart));
+
+      if (psOther->sProcess.iBinary == 1) {
+         Protocol_pack(aucFrame, row * 8 + column,
+                       (iRet != 0 && Board_getPlayer(oMatch->oBoard)
+                        == player) ? PROTOCOL_PASS : 0, oMatch->count);
+         (void)write(psOther->sProcess.iToChild, aucFrame,
+                     sizeof(aucFrame));
+         oMatch->uSent = Metrics_now();
+         oMatch->iSentTo = 3 - player;
+      }
+      oMatch->count++; /* Increment move count. */
+
+      /* Record the move, and the pass of the other player if the same
+         player moves again. */
+      if (oMatch->oRecord != NULL) {
+         Record_addMove(&oMatch->sRecord, row, column);
+         if (iRet != 0 && Board_getPlayer(oMatch->oBoard) == player)
+            Record_addMove(&oMatch->sRecord, -1, -1);
+      }
+
+      /* If there are no more valid moves, end the game.*/
+      if (iRet == 0) {
+         oMatch->iScore = Board_endGame(oMatch->oBoard, oMatch->player1,
+                                        oMatch->player2);
+         oMatch->oBoard = NULL;
+         oMatch->iOver = 1;
+         writeRecord(oMatch);
+      }
+      else startTurn(oMatch);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Gets the player file player ready to play as role ("FIRST" or
+   "SECOND") in psPlayer: takes an idle process from oPool or starts a
+   new one and sends it NEWGAME if the player is pooled, and starts it
+   with role as its argument if not. A player that is started is
+   offered the binary protocol if iBinary is 1. Returns 1 if
+   successful and 0 if not. */
+
+static int openPlayer(Pool_T oPool, char *player, char *role,
+                      int iBinary, struct Player *psPlayer) {
+
+   char acNewGame[MOVE_SIZE];
+   int iLength;
+
+   psPlayer->iLength = 0;
+   psPlayer->iEof = 0;
+   psPlayer->iPooled = (oPool != NULL && Pool_isPooled(oPool, player));
+   if (psPlayer->iPooled == 0)
+      return startPlayer(player, role, iBinary, &psPlayer->sProcess);
+
+   if (Pool_take(oPool, player, &psPlayer->sProcess) == 0
+       && startPlayer(player, "POOL", iBinary, &psPlayer->sProcess)
+          == 0)
+      return 0;
+   iLength = sprintf(acNewGame, "NEWGAME %s\n", role);
+   (void)write(psPlayer->sProcess.iToChild, acNewGame, (size_t)iLength);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Sends ENDGAME to the player psPlayer of oMatch and gives it back to
+   the pool if it is pooled and played its part of the game properly,
+   and stops it if not. */
+
+static void closePlayer(Match_T oMatch, char *player,
+                        struct Player *psPlayer) {
+
+   if (psPlayer->iPooled == 0 || psPlayer->iEof == 1
+       || oMatch->iLoser == (int)(psPlayer - oMatch->asPlayers) + 1) {
+      Pool_stop(&psPlayer->sProcess);
+      return;
+   }
+   (void)write(psPlayer->sProcess.iToChild, "ENDGAME\n", 8);
+   psPlayer->sProcess.iPending++;
+   Pool_give(oMatch->oPool, player, &psPlayer->sProcess);
+}
+
+/*--------------------------------------------------------------------*/
+Match_T Match_new(char *player1, char *player2, int tracking,
+                  FILE *psFile, long lMoveMillis, long lGameMillis,
+                  int iBinary, Pool_T oPool, Record_T oRecord) {
+
+   Match_T oMatch;
+
+   assert(player1 != NULL);
+   assert(player2 != NULL);
+
+   oMatch = (Match_T)calloc(1, sizeof(struct Match));
+   if (oMatch == NULL) return NULL;
+
+   /* The timer is only needed if there is a time limit. */
+   oMatch->iTimer = -1;
+   if (lMoveMillis > 0 || lGameMillis > 0) {
+      oMatch->iTimer = timerfd_create(CLOCK_MONOTONIC,
+                                      TFD_NONBLOCK | TFD_CLOEXEC);
+      if (oMatch->iTimer == -1) {
+         free(oMatch);
+         return NULL;
+      }
+   }
+
+   /* Start both players. */
+   if (openPlayer(oPool, player1, "FIRST", iBinary & 1,
+                  &oMatch->asPlayers[0]) == 0) {
+      if (oMatch->iTimer != -1) close(oMatch->iTimer);
+      free(oMatch);
+      return NULL;
+   }
+   if (openPlayer(oPool, player2, "SECOND", (iBinary >> 1) & 1,
+                  &oMatch->asPlayers[1]) == 0) {
+      Pool_stop(&oMatch->asPlayers[0].sProcess);
+      if (oMatch->iTimer != -1) close(oMatch->iTimer);
+      free(oMatch);
+      return NULL;
+   }
+
+   /* Start the game, set move count equal to 0. */
+   oMatch->player1 = player1;
+   oMatch->player2 = player2;
+   oMatch->oPool = oPool;
+   oMatch->iLoser = 0;
+   oMatch->oRecord = oRecord;
+   if (oRecord != NULL) Record_start(&oMatch->sRecord, player1, player2);
+   oMatch->tracking = tracking;
+   oMatch->psFile = psFile;
+   oMatch->count = 0;
+   oMatch->iOver = 0;
+   oMatch->lMoveMillis = lMoveMillis;
+   oMatch->lGameMillis = lGameMillis;
+   oMatch->alLeft[0] = lGameMillis;
+   oMatch->alLeft[1] = lGameMillis;
+   oMatch->oBoard = Board_initIn(&oMatch->sBoard, tracking, psFile);
+   if (tracking == 1) Record_printStart(oMatch->oBoard, psFile);
+   startTurn(oMatch);
+   return oMatch;
+}
+
+/*--------------------------------------------------------------------*/
+int Match_getFd(Match_T oMatch, int player) {
+   assert(oMatch != NULL);
+   assert(player == 1 || player == 2);
+   return oMatch->asPlayers[player - 1].sProcess.iFromChild;
+}
+
+/*--------------------------------------------------------------------*/
+int Match_read(Match_T oMatch, int player) {
+
+   assert(oMatch != NULL);
+   assert(player == 1 || player == 2);
+
+   if (oMatch->iOver == 1) return 1;
+   fillBuffer(&oMatch->asPlayers[player - 1]);
+   playMoves(oMatch);
+   return oMatch->iOver;
+}
+
+/*--------------------------------------------------------------------*/
+int Match_getTimerFd(Match_T oMatch) {
+   assert(oMatch != NULL);
+   return oMatch->iTimer;
+}
+
+/*--------------------------------------------------------------------*/
+int Match_expire(Match_T oMatch) {
+
+   uint64_t uExpired;
+
+   assert(oMatch != NULL);
+
+   if (oMatch->iOver == 1) return 1;
+   if (oMatch->iTimer != -1)
+      (void)read(oMatch->iTimer, &uExpired, sizeof(uExpired));
+
+   /* A move that is already in the pipe may end the turn. Then the
+      timer has been set again for the next one. */
+   fillBuffer(&oMatch->asPlayers[Board_getPlayer(oMatch->oBoard) - 1]);
+   playMoves(oMatch);
+   if (oMatch->iOver == 0 && oMatch->lDeadline != 0
+       && Metrics_millis() >= oMatch->lDeadline)
+      endBadly(oMatch, 2);
+   return oMatch->iOver;
+}
+
+/*--------------------------------------------------------------------*/
+int Match_isOver(Match_T oMatch) {
+   assert(oMatch != NULL);
+   return oMatch->iOver;
+}
+
+/*--------------------------------------------------------------------*/
+int Match_getScore(Match_T oMatch) {
+   assert(oMatch != NULL);
+   assert(oMatch->iOver == 1);
+   return oMatch->iScore;
+}
+
+/*--------------------------------------------------------------------*/
+const struct Metrics_Histogram *Match_getThinkTimes(Match_T oMatch,
+                                                    int player) {
+   assert(oMatch != NULL);
+   assert(player == 1 || player == 2);
+   return &oMatch->asThink[player - 1];
+}
+
+/*--------------------------------------------------------------------*/
+const struct Metrics_Histogram *Match_getRefereeTimes(Match_T oMatch,
+                                                      int player) {
+   assert(oMatch != NULL);
+   assert(player == 1 || player == 2);
+   return &oMatch->asReferee[player - 1];
+}
+
+/*--------------------------------------------------------------------*/
+void Match_writeMetrics(Match_T oMatch, int iGame, FILE *psFile) {
+
+   static const char *apcKinds[2] = {"think", "referee"};
+   static const char *apcRoles[2] = {"FIRST", "SECOND"};
+   char acPrefix[PREFIX_SIZE];
+   int iKind, i;
+
+   assert(oMatch != NULL);
+   assert(psFile != NULL);
+
+   for (iKind = 0; iKind < 2; iKind++) {
+      for (i = 0; i < 2; i++) {
+         snprintf(acPrefix, sizeof(acPrefix),
+                  "game=%d player=%s role=%s kind=%s ", iGame,
+                  (i == 0) ? oMatch->player1 : oMatch->player2,
+                  apcRoles[i], apcKinds[iKind]);
+         Metrics_write(psFile, acPrefix, (iKind == 0)
+                       ? &oMatch->asThink[i] : &oMatch->asReferee[i]);
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+void Match_abort(Match_T oMatch) {
+   assert(oMatch != NULL);
+   if (oMatch->iOver == 0) endBadly(oMatch, 1);
+}
+
+/*--------------------------------------------------------------------*/
+void Match_free(Match_T oMatch) {
+
+   assert(oMatch != NULL);
+
+   Match_abort(oMatch);
+
+   /* Close pipes and kill children, or keep them for the next game. */
+   closePlayer(oMatch, oMatch->player1, &oMatch->asPlayers[0]);
+   closePlayer(oMatch, oMatch->player2, &oMatch->asPlayers[1]);
+   if (oMatch->iTimer != -1) close(oMatch->iTimer);
+   free(oMatch);
+}
+/*--------------------------------------------------------------------*/
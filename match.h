@@ -0,0 +1,91 @@
+/*--------------------------------------------------------------------*/
+/* match.h                                                            */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef MATCH_INCLUDED
+#define MATCH_INCLUDED
+
+#include <stdio.h>
+#include "metrics.h"
+#include "pool.h"
+#include "record.h"
+
+/* A Match is a game of othello between two player files that is
+   driven by the pipes of the players instead of blocking on them. The
+   pipes that moves are read from are non-blocking, and every time one
+   of them becomes readable the caller hands it to Match_read, which
+   plays whatever moves have arrived. That way one thread can drive
+   many matches at once. */
+
+typedef struct Match *Match_T;
+
+/* Starts the player files player1 (FIRST) and player2 (SECOND) in the
+   current directory and sets up a match between them. If tracking is
+   1 the game is written to psFile, which is closed when it ends. A
+   player that takes longer than lMoveMillis milliseconds of wall clock
+   time for a move, or lGameMillis for all of its moves, loses (0 for
+   no limit). iBinary tells which players are offered the binary
+   protocol of protocol.h: 1 for FIRST, 2 for SECOND, 3 for both and 0
+   for neither. Players added to oPool are taken from it, or started
+   for it, unless oPool is NULL. The record of the game is written to
+   oRecord when it ends unless oRecord is NULL. Returns the match, or
+   NULL if the players could not be started. */
+Match_T Match_new(char *player1, char *player2, int tracking,
+                  FILE *psFile, long lMoveMillis, long lGameMillis,
+                  int iBinary, Pool_T oPool, Record_T oRecord);
+
+/* Returns the descriptor of the pipe that the moves of player (1 or 2)
+   in oMatch are read from. */
+int Match_getFd(Match_T oMatch, int player);
+
+/* Reads what player (1 or 2) has written to oMatch and plays the moves
+   it can. Returns 1 if the game is over and 0 if not. */
+int Match_read(Match_T oMatch, int player);
+
+/* Returns the descriptor of a timer that becomes readable when the
+   current player of oMatch runs out of time, or -1 if it has no time
+   limit. */
+int Match_getTimerFd(Match_T oMatch);
+
+/* Ends the game of oMatch if the current player has run out of time,
+   after playing any moves that have arrived. Called when its timer is
+   readable. Returns 1 if the game is over and 0 if not. */
+int Match_expire(Match_T oMatch);
+
+/* Returns 1 if the game of oMatch is over and 0 if not. */
+int Match_isOver(Match_T oMatch);
+
+/* Returns the score of the game of oMatch, i.e. FIRST's tiles minus
+   SECOND's. The game must be over. */
+int Match_getScore(Match_T oMatch);
+
+/* Returns the histogram of how long player (1 or 2) of oMatch took
+   for each of its moves so far: from when the other player's move was
+   written to it, or its turn started if it had none to wait for, to
+   when its own move had been read. */
+const struct Metrics_Histogram *Match_getThinkTimes(Match_T oMatch,
+                                                    int player);
+
+/* Returns the histogram of how long the referee took to check and
+   play each move of player (1 or 2) of oMatch so far: to check that
+   it is valid, make it and draw the board after it, but not to read
+   it or write it to the other player. */
+const struct Metrics_Histogram *Match_getRefereeTimes(Match_T oMatch,
+                                                      int player);
+
+/* Writes the histograms of oMatch, game number iGame, to psFile (see
+   Metrics_write): a line for the moves of each player, then one for
+   the referee's time on each player's moves. Each line starts with
+   game=iGame, the player's name, its role and kind=think or
+   kind=referee. */
+void Match_writeMetrics(Match_T oMatch, int iGame, FILE *psFile);
+
+/* Ends the game of oMatch if it is not over yet, as if the current
+   player had crashed. */
+void Match_abort(Match_T oMatch);
+
+/* Kills the players of oMatch, or gives them back to their pool, and
+   frees it. A game that is not over is ended first by Match_abort. */
+void Match_free(Match_T oMatch);
+
+#endif
@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------*/
+/* metrics.c                                                          */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for clock_gettime */
+#include <time.h>
+#include <assert.h>
+#include "metrics.h"
+
+/* Buckets of each power of two, as a power of two. */
+enum {SUB_BITS = 3, SUB_BUCKETS = 1 << SUB_BITS};
+
+/*--------------------------------------------------------------------*/
+/* Returns the bucket of a duration of uNanos nanoseconds. */
+
+static int bucketOf(uint64_t uNanos) {
+
+   int iLog;
+
+   if (uNanos < SUB_BUCKETS) return (int)uNanos;
+
+   /* The highest bit picks the power of two, the bits below it the
+      bucket within it. */
+#ifdef __GNUC__
+   iLog = 63 - __builtin_clzll(uNanos);
+#else
+   for (iLog = 63; (uNanos >> iLog) == 0; iLog--);
+#endif
+   return (iLog - SUB_BITS + 1) * SUB_BUCKETS
+      + (int)((uNanos >> (iLog - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the shortest duration in nanoseconds of bucket iBucket. */
+
+static uint64_t lowestOf(int iBucket) {
+
+   int iLog;
+
+   if (iBucket < SUB_BUCKETS) return (uint64_t)iBucket;
+   iLog = iBucket / SUB_BUCKETS + SUB_BITS - 1;
+   return (uint64_t)(SUB_BUCKETS + iBucket % SUB_BUCKETS)
+      << (iLog - SUB_BITS);
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Metrics_now(void) {
+
+   struct timespec sNow;
+
+   clock_gettime(CLOCK_MONOTONIC, &sNow);
+   return (uint64_t)sNow.tv_sec * 1000000000u + (uint64_t)sNow.tv_nsec;
+}
+
+/*--------------------------------------------------------------------*/
+long Metrics_millis(void) {
+
+   struct timespec sNow;
+
+   clock_gettime(CLOCK_MONOTONIC, &sNow);
+   return (long)sNow.tv_sec * 1000 + sNow.tv_nsec / 1000000;
+}
+
+/*--------------------------------------------------------------------*/
+void Metrics_add(struct Metrics_Histogram *psHistogram, uint64_t uNanos) {
+
+   assert(psHistogram != NULL);
+
+   psHistogram->auBuckets[bucketOf(uNanos)]++;
+   psHistogram->uCount++;
+   psHistogram->uSum += uNanos;
+   if (uNanos > psHistogram->uMax) psHistogram->uMax = uNanos;
+}
+
+/*--------------------------------------------------------------------*/
+void Metrics_merge(struct Metrics_Histogram *psInto,
+                   const struct Metrics_Histogram *psFrom) {
+
+   int i;
+
+   assert(psInto != NULL);
+   assert(psFrom != NULL);
+
+   for (i = 0; i < METRICS_BUCKETS; i++)
+      psInto->auBuckets[i] += psFrom->auBuckets[i];
+   psInto->uCount += psFrom->uCount;
+   psInto->uSum += psFrom->uSum;
+   if (psFrom->uMax > psInto->uMax) psInto->uMax = psFrom->uMax;
+}
+
+/*--------------------------------------------------------------------*/
+uint64_t Metrics_percentile(const struct Metrics_Histogram *psHistogram,
+                            double dFraction) {
+
+   uint64_t uRank, uSeen, uHighest;
+   int i;
+
+   assert(psHistogram != NULL);
+   assert(dFraction >= 0.0 && dFraction <= 1.0);
+
+   if (psHistogram->uCount == 0) return 0;
+
+   /* The rank of the duration, counting from 1, rounded up. */
+   uRank = (uint64_t)(dFraction * (double)psHistogram->uCount);
+   if ((double)uRank < dFraction * (double)psHistogram->uCount) uRank++;
+   if (uRank == 0) uRank = 1;
+
+   /* Report the longest duration of its bucket, but never more than
+      the longest there was. */
+   uSeen = 0;
+   for (i = 0; i < METRICS_BUCKETS - 1; i++) {
+      uSeen += psHistogram->auBuckets[i];
+      if (uSeen >= uRank) break;
+   }
+   uHighest = (i == METRICS_BUCKETS - 1) ? psHistogram->uMax
+      : lowestOf(i + 1) - 1;
+   return (uHighest < psHistogram->uMax) ? uHighest : psHistogram->uMax;
+}
+
+/*--------------------------------------------------------------------*/
+void Metrics_write(FILE *psFile, const char *pcPrefix,
+                   const struct Metrics_Histogram *psHistogram) {
+
+   const char *pcSeparator;
+   int i;
+
+   assert(psFile != NULL);
+   assert(pcPrefix != NULL);
+   assert(psHistogram != NULL);
+
+   fprintf(psFile, "%scount=%llu mean_ns=%llu p50_ns=%llu p90_ns=%llu "
+           "p99_ns=%llu max_ns=%llu hist=", pcPrefix,
+           (unsigned long long)psHistogram->uCount,
+           (unsigned long long)(psHistogram->uCount == 0 ? 0
+                                : psHistogram->uSum
+                                  / psHistogram->uCount),
+           (unsigned long long)Metrics_percentile(psHistogram, 0.50),
+           (unsigned long long)Metrics_percentile(psHistogram, 0.90),
+           (unsigned long long)Metrics_percentile(psHistogram, 0.99),
+           (unsigned long long)psHistogram->uMax);
+   pcSeparator = "";
+   for (i = 0; i < METRICS_BUCKETS; i++) {
+      if (psHistogram->auBuckets[i] == 0) continue;
+      fprintf(psFile, "%s%llu:%llu", pcSeparator,
+              (unsigned long long)lowestOf(i),
+              (unsigned long long)psHistogram->auBuckets[i]);
+      pcSeparator = ",";
+   }
+   fprintf(psFile, "\n");
+}
+/*--------------------------------------------------------------------*/
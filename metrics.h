@@ -0,0 +1,62 @@
+/*--------------------------------------------------------------------*/
+/* metrics.h                                                          */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef METRICS_INCLUDED
+#define METRICS_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* A latency histogram counts durations in nanoseconds in buckets that
+   grow with the duration: durations below 8 ns each have a bucket of
+   their own, and every power of two above that is split into 8
+   buckets, so that a percentile read from the histogram is never more
+   than an eighth too high. Adding a duration takes a few instructions
+   and no memory besides the histogram, so the hot path of the referee
+   can be measured on every move. A histogram that is all zeros is
+   empty. */
+
+/* Number of buckets of a histogram. */
+enum {METRICS_BUCKETS = 496};
+
+/* A latency histogram. */
+struct Metrics_Histogram {
+   /* How many durations fell in each bucket. */
+   uint64_t auBuckets[METRICS_BUCKETS];
+
+   /* How many durations there were, their sum and the longest. */
+   uint64_t uCount;
+   uint64_t uSum;
+   uint64_t uMax;
+};
+
+/* Returns the time in nanoseconds of the monotonic clock. */
+uint64_t Metrics_now(void);
+
+/* Returns the time in milliseconds of the monotonic clock, for
+   deadlines and timings too long to need Metrics_now. */
+long Metrics_millis(void);
+
+/* Adds the duration of uNanos nanoseconds to *psHistogram. */
+void Metrics_add(struct Metrics_Histogram *psHistogram, uint64_t uNanos);
+
+/* Adds every duration of *psFrom to *psInto. */
+void Metrics_merge(struct Metrics_Histogram *psInto,
+                   const struct Metrics_Histogram *psFrom);
+
+/* Returns the duration in nanoseconds that the fraction dFraction (0
+   to 1) of the durations of *psHistogram do not exceed, or 0 if it is
+   empty. */
+uint64_t Metrics_percentile(const struct Metrics_Histogram *psHistogram,
+                            double dFraction);
+
+/* Writes *psHistogram to psFile as one line of space-separated
+   key=value fields, after pcPrefix (which should end in a space):
+   count, mean_ns, p50_ns, p90_ns, p99_ns and max_ns, then hist, the
+   buckets that are not empty as comma-separated lowest_ns:count
+   pairs. */
+void Metrics_write(FILE *psFile, const char *pcPrefix,
+                   const struct Metrics_Histogram *psHistogram);
+
+#endif
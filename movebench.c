@@ -0,0 +1,405 @@
+/*--------------------------------------------------------------------*/
+/* movebench.c                                                        */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for clock_gettime */
+#include <time.h>
+#include "board.h"
+#include "bitboard.h"
+#include "batch.h"
+#include "eval.h"
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Number of random games that the benchmark positions come from. */
+enum {GAMES = 2000};
+
+/* Most positions a game can contribute. */
+enum {MAX_PLIES = 64};
+
+/* Number of times every position is scanned per measurement. */
+enum {ROUNDS = 200};
+
+/*--------------------------------------------------------------------*/
+
+/* A benchmark position, both as the 8 by 8 array that board.c used
+   to scan and as the bitboards of the current and the other player. */
+struct Position {
+   int board[SIZE][SIZE];
+   int player;
+   uint64_t uOwn;
+   uint64_t uOpp;
+};
+
+/* A legal move in one of the benchmark positions. */
+struct Move {
+   uint64_t uOwn;
+   uint64_t uOpp;
+   int iSquare;
+};
+
+/*--------------------------------------------------------------------*/
+/* Checks that the tile at row and column of psPos borders a run of
+   the other player's tiles closed off by a tile of the current player
+   in direction dy, dx. Returns 1 if it does and 0 if not. This is the
+   ray probe that Board_nextMove() used to make 8 times per tile. */
+
+static int rayIsLegal(struct Position *psPos, int row, int column,
+                      int dy, int dx) {
+
+   int rTemp;
+   int cTemp;
+   int other;
+
+   other = 3 - psPos->player;
+   rTemp = row + dy;
+   cTemp = column + dx;
+   while ((cTemp < SIZE) && (cTemp >= 0) && (rTemp < SIZE)
+          && (rTemp >= 0) && (psPos->board[rTemp][cTemp] == other)) {
+      rTemp = rTemp + dy;
+      cTemp = cTemp + dx;
+      if ((cTemp < SIZE) && (cTemp >= 0) && (rTemp < SIZE)
+          && (rTemp >= 0)) {
+         if (psPos->board[rTemp][cTemp] == psPos->player) return 1;
+      }
+   }
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+/* Finds every legal move in psPos by probing all 8 directions around
+   each of the 64 tiles. Returns the moves as a bitboard. */
+
+static uint64_t scanMoves(struct Position *psPos) {
+
+   int row, column, dy, dx;
+   uint64_t uMoves;
+
+   uMoves = 0;
+   for (row = 0; row < SIZE; row++) {
+      for (column = 0; column < SIZE; column++) {
+         if (psPos->board[row][column] != 0) continue;
+         for (dy = -1; dy <= 1; dy++) {
+            for (dx = -1; dx <= 1; dx++) {
+               if ((dy != 0 || dx != 0)
+                   && rayIsLegal(psPos, row, column, dy, dx) == 1) {
+                  uMoves |= Bitboard_square(row, column);
+                  dy = dx = 2; /* Stop probing this tile. */
+               }
+            }
+         }
+      }
+   }
+   return uMoves;
+}
+
+/*--------------------------------------------------------------------*/
+/* Stores the position on oBoard in psPos. */
+
+static void savePosition(Board_T oBoard, struct Position *psPos) {
+
+   int row, column;
+   char symbol;
+
+   psPos->player = Board_getPlayer(oBoard);
+   psPos->uOwn = 0;
+   psPos->uOpp = 0;
+   for (row = 0; row < SIZE; row++) {
+      for (column = 0; column < SIZE; column++) {
+         symbol = Board_getSymbol(oBoard, row, column);
+         psPos->board[row][column] = 0;
+         if (symbol == 'x') psPos->board[row][column] = 1;
+         if (symbol == 'o') psPos->board[row][column] = 2;
+         if (psPos->board[row][column] == psPos->player)
+            psPos->uOwn |= Bitboard_square(row, column);
+         else if (psPos->board[row][column] != 0)
+            psPos->uOpp |= Bitboard_square(row, column);
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays GAMES random games and stores every position reached in
+   psPositions. Returns the number of positions stored. */
+
+static int makePositions(struct Position *psPositions) {
+
+   struct Board_Storage sBoard;
+   Board_T oBoard;
+   uint64_t uMoves;
+   int iGame, iCount, iPick, iSquare;
+
+   iCount = 0;
+   srand(1);
+   for (iGame = 0; iGame < GAMES; iGame++) {
+      oBoard = Board_initIn(&sBoard, 0, NULL);
+      do {
+         savePosition(oBoard, &psPositions[iCount++]);
+
+         /* Play a random legal move. */
+         uMoves = Board_legalMoves(oBoard);
+         iPick = rand() % Bitboard_count(uMoves);
+         for (iSquare = 0; iPick > 0 || (uMoves & 1) == 0; iSquare++) {
+            if ((uMoves & 1) != 0) iPick--;
+            uMoves >>= 1;
+         }
+         Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+      } while (Board_draw(oBoard) != 0);
+   }
+   return iCount;
+}
+
+/*--------------------------------------------------------------------*/
+/* Computes the flips of the iMoves moves in psMoves ROUNDS times with
+   the flip kernel pcKernel. Stores the flips of each move in puFlips
+   if iCheck is 0, and checks them against puFlips if not. Prints moves
+   per second. Returns 0, or 1 if the kernel disagrees with puFlips. */
+
+static int timeFlips(struct Move *psMoves, int iMoves,
+                     const char *pcKernel, uint64_t *puFlips,
+                     int iCheck) {
+
+   int i, iRound;
+   uint64_t uFlips, uSum;
+   clock_t tStart;
+   double dTime;
+
+   if (Bitboard_setFlipKernel(pcKernel) == 0) {
+      printf("%-6s flips:    (not supported)\n", pcKernel);
+      return 0;
+   }
+
+   for (i = 0; i < iMoves; i++) {
+      uFlips = Bitboard_flips(psMoves[i].uOwn, psMoves[i].uOpp,
+                              psMoves[i].iSquare);
+      if (iCheck == 1 && puFlips[i] != uFlips) {
+         fprintf(stderr, "%s flips disagree on move %d\n", pcKernel, i);
+         return 1;
+      }
+      puFlips[i] = uFlips;
+   }
+
+   uSum = 0;
+   tStart = clock();
+   for (iRound = 0; iRound < ROUNDS; iRound++) {
+      for (i = 0; i < iMoves; i++)
+         uSum += Bitboard_flips(psMoves[i].uOwn, psMoves[i].uOpp,
+                                psMoves[i].iSquare);
+   }
+   dTime = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+   printf("%-6s flips:    %12.0f moves/s (checksum %08x)\n", pcKernel,
+          (double)iMoves * ROUNDS / dTime, (unsigned)uSum);
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+/* Looks at the iCount positions of psPositions with the batch API,
+   first checking that it finds the same moves as the legal move mask.
+   Prints positions per second of wall clock time with one thread and
+   with one per processor. Returns 0, or 1 if the moves disagree. */
+
+static int timeBatch(struct Position *psPositions, int iCount) {
+
+   struct Batch_Position *psBatch;
+   struct Batch_Output sOutput;
+   struct timespec sStart, sEnd;
+   uint64_t *puMoves;
+   uint8_t *pucMobility, *pucStatus;
+   double dTime;
+   int i, iRound, iThreads;
+
+   psBatch = calloc((size_t)iCount, sizeof(struct Batch_Position));
+   assert(psBatch != NULL);
+   puMoves = calloc((size_t)iCount, sizeof(uint64_t));
+   assert(puMoves != NULL);
+   pucMobility = calloc((size_t)iCount, 1);
+   assert(pucMobility != NULL);
+   pucStatus = calloc((size_t)iCount, 1);
+   assert(pucStatus != NULL);
+   for (i = 0; i < iCount; i++) {
+      psBatch[i].uOwn = psPositions[i].uOwn;
+      psBatch[i].uOpp = psPositions[i].uOpp;
+   }
+   memset(&sOutput, 0, sizeof(sOutput));
+   sOutput.puMoves = puMoves;
+   sOutput.pucMobility = pucMobility;
+   sOutput.pucStatus = pucStatus;
+
+   Batch_evaluate(psBatch, (size_t)iCount, &sOutput, 0);
+   for (i = 0; i < iCount; i++) {
+      if (puMoves[i] != Bitboard_legalMoves(psBatch[i].uOwn,
+                                            psBatch[i].uOpp)
+          || pucStatus[i] != BATCH_MOVE) {
+         fprintf(stderr, "Batch disagrees on position %d\n", i);
+         free(pucStatus);
+         free(pucMobility);
+         free(puMoves);
+         free(psBatch);
+         return 1;
+      }
+   }
+
+   for (iThreads = 1; iThreads >= 0; iThreads--) {
+      clock_gettime(CLOCK_MONOTONIC, &sStart);
+      for (iRound = 0; iRound < ROUNDS; iRound++)
+         Batch_evaluate(psBatch, (size_t)iCount, &sOutput, iThreads);
+      clock_gettime(CLOCK_MONOTONIC, &sEnd);
+      dTime = (double)(sEnd.tv_sec - sStart.tv_sec)
+         + (double)(sEnd.tv_nsec - sStart.tv_nsec) / 1e9;
+      printf("%-17s%12.0f positions/s\n",
+             iThreads == 1 ? "batch, 1 thread:" : "batch, threads:",
+             (double)iCount * ROUNDS / dTime);
+   }
+
+   free(pucStatus);
+   free(pucMobility);
+   free(puMoves);
+   free(psBatch);
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+/* Evaluates the iCount positions of psPositions ROUNDS times with the
+   made up weights, first checking that each is worth the same upside
+   down, as the weights are symmetric. Prints positions per second.
+   Returns 0, or 1 if a position is not. */
+
+static int timeEval(struct Position *psPositions, int iCount) {
+
+   struct Batch_Position *psPacked;
+   int i, iRound;
+   long lSum;
+   clock_t tStart;
+   double dTime;
+
+   Eval_init();
+   for (i = 0; i < iCount; i++) {
+      if (Eval_evaluate(psPositions[i].uOwn, psPositions[i].uOpp)
+          != Eval_evaluate(Bitboard_flip(psPositions[i].uOwn),
+                           Bitboard_flip(psPositions[i].uOpp))) {
+         fprintf(stderr, "Evaluation is not symmetric on position %d\n",
+                 i);
+         return 1;
+      }
+   }
+
+   /* Time it on packed positions, as a search would see them, rather
+      than on the much larger struct Position. */
+   psPacked = calloc((size_t)iCount, sizeof(struct Batch_Position));
+   assert(psPacked != NULL);
+   for (i = 0; i < iCount; i++) {
+      psPacked[i].uOwn = psPositions[i].uOwn;
+      psPacked[i].uOpp = psPositions[i].uOpp;
+   }
+   lSum = 0;
+   tStart = clock();
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+      for (i = 0; i < iCount; i++)
+         lSum += Eval_evaluate(psPacked[i].uOwn, psPacked[i].uOpp);
+   dTime = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+   printf("evaluation:      %12.0f positions/s (checksum %08x)\n",
+          (double)iCount * ROUNDS / dTime, (unsigned)lSum);
+   free(psPacked);
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+/* Compares the legal move bitmask against the per-tile scan on the
+   positions of a batch of random games, first checking that both find
+   the same moves. Prints positions per second for each, then moves
+   per second for each flip kernel and positions per second for the
+   batch API and the static evaluation. Returns 0, or 1 if move
+   generators, flip kernels or the batch API disagree or the
+   evaluation is not symmetric. */
+
+int main(void) {
+
+   struct Position *psPositions;
+   struct Move *psMoves;
+   uint64_t *puFlips;
+   uint64_t uMoves;
+   const char *pcDefault;
+   int iCount, iMoves, i, iRound, iSquare, iRet;
+   uint64_t uSum;
+   clock_t tStart;
+   double dScan, dMask;
+
+   psPositions = calloc((size_t)GAMES * MAX_PLIES,
+                        sizeof(struct Position));
+   assert(psPositions != NULL);
+   iCount = makePositions(psPositions);
+
+   for (i = 0; i < iCount; i++) {
+      if (scanMoves(&psPositions[i])
+          != Bitboard_legalMoves(psPositions[i].uOwn,
+                                 psPositions[i].uOpp)) {
+         fprintf(stderr, "Move generators disagree on position %d\n", i);
+         free(psPositions);
+         return 1;
+      }
+   }
+
+   /* Time the old scan. */
+   uSum = 0;
+   tStart = clock();
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+      for (i = 0; i < iCount; i++) uSum += scanMoves(&psPositions[i]);
+   dScan = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+
+   /* Time the whole-board mask. */
+   tStart = clock();
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+      for (i = 0; i < iCount; i++)
+         uSum -= Bitboard_legalMoves(psPositions[i].uOwn,
+                                     psPositions[i].uOpp);
+   dMask = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+
+   printf("%d positions, %d rounds (difference %d)\n", iCount, ROUNDS,
+          (int)(uSum != 0));
+   printf("per-tile scan:   %12.0f positions/s\n",
+          (double)iCount * ROUNDS / dScan);
+   printf("legal move mask: %12.0f positions/s\n",
+          (double)iCount * ROUNDS / dMask);
+   printf("speedup:         %12.1fx\n", dScan / dMask);
+   if (timeBatch(psPositions, iCount) == 1
+       || timeEval(psPositions, iCount) == 1) {
+      free(psPositions);
+      return 1;
+   }
+
+   /* List every legal move of every position. */
+   iMoves = 0;
+   for (i = 0; i < iCount; i++)
+      iMoves += Bitboard_count(Bitboard_legalMoves(psPositions[i].uOwn,
+                                                   psPositions[i].uOpp));
+   psMoves = calloc((size_t)iMoves, sizeof(struct Move));
+   assert(psMoves != NULL);
+   puFlips = calloc((size_t)iMoves, sizeof(uint64_t));
+   assert(puFlips != NULL);
+   iMoves = 0;
+   for (i = 0; i < iCount; i++) {
+      uMoves = Bitboard_legalMoves(psPositions[i].uOwn,
+                                   psPositions[i].uOpp);
+      for (iSquare = 0; iSquare < SIZE * SIZE; iSquare++) {
+         if ((uMoves & ((uint64_t)1 << iSquare)) == 0) continue;
+         psMoves[iMoves].uOwn = psPositions[i].uOwn;
+         psMoves[iMoves].uOpp = psPositions[i].uOpp;
+         psMoves[iMoves].iSquare = iSquare;
+         iMoves++;
+      }
+   }
+
+   /* Time every flip kernel on the same moves. */
+   pcDefault = Bitboard_getFlipKernel();
+   iRet = timeFlips(psMoves, iMoves, "scalar", puFlips, 0);
+   if (iRet == 0) iRet = timeFlips(psMoves, iMoves, "sse2", puFlips, 1);
+   if (iRet == 0) iRet = timeFlips(psMoves, iMoves, "avx2", puFlips, 1);
+   printf("default kernel: %s\n", pcDefault);
+
+   free(puFlips);
+   free(psMoves);
+   free(psPositions);
+   return iRet;
+}
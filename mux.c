@@ -0,0 +1,170 @@
+/*--------------------------------------------------------------------*/
+/* mux.c                                                              */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "mux.h"
+
+/* Most events taken from epoll at a time. */
+enum {MAX_EVENTS = 64};
+
+/* What an event of a slot is for: the pipe of the FIRST or the SECOND
+   player or the timer, and the number of them. */
+enum {KEY_FIRST, KEY_SECOND, KEY_TIMER, KEYS};
+
+/*--------------------------------------------------------------------*/
+
+/* A game in progress. */
+struct Slot {
+   /* The match, or NULL if the slot is free. */
+   Match_T oMatch;
+
+   /* What the caller gave back with it. */
+   void *pvGame;
+};
+
+/*--------------------------------------------------------------------*/
+/* Adds the pipes of both players of the match in slot iSlot, and its
+   timer if it has one, to the epoll instance iEpoll. Every event
+   carries the slot and what it is for: KEY_FIRST, KEY_SECOND or
+   KEY_TIMER. Returns 1 if successful and 0 if not. */
+
+static int watchMatch(int iEpoll, Match_T oMatch, int iSlot) {
+
+   struct epoll_event sEvent;
+   int player;
+
+   for (player = 1; player <= 2; player++) {
+      /* Edge triggered: Match_read reads the pipe until it is empty or
+         the move it needs has arrived, and anything left is read when
+         it is that player's turn. */
+      sEvent.events = EPOLLIN | EPOLLET;
+      sEvent.data.u64 = (uint64_t)(KEYS * iSlot + player - 1);
+      if (epoll_ctl(iEpoll, EPOLL_CTL_ADD, Match_getFd(oMatch, player),
+                    &sEvent) == -1)
+         return 0;
+   }
+   if (Match_getTimerFd(oMatch) != -1) {
+      sEvent.events = EPOLLIN | EPOLLET;
+      sEvent.data.u64 = (uint64_t)(KEYS * iSlot + KEY_TIMER);
+      if (epoll_ctl(iEpoll, EPOLL_CTL_ADD, Match_getTimerFd(oMatch),
+                    &sEvent) == -1)
+         return 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Ends the game in slot psSlot: takes its pipes out of the epoll
+   instance iEpoll, cuts it short if it is not over, hands it to
+   pfFinish with pvExtra and frees its match. The pipes are taken out
+   explicitly because a child started by another thread may still hold
+   them open for a moment. */
+
+static void endSlot(int iEpoll, struct Slot *psSlot,
+                    Mux_Finish pfFinish, void *pvExtra) {
+
+   int player;
+
+   for (player = 1; player <= 2; player++)
+      epoll_ctl(iEpoll, EPOLL_CTL_DEL,
+                Match_getFd(psSlot->oMatch, player), NULL);
+   if (Match_getTimerFd(psSlot->oMatch) != -1)
+      epoll_ctl(iEpoll, EPOLL_CTL_DEL, Match_getTimerFd(psSlot->oMatch),
+                NULL);
+   Match_abort(psSlot->oMatch);
+   pfFinish(pvExtra, psSlot->pvGame, psSlot->oMatch);
+   Match_free(psSlot->oMatch);
+   psSlot->oMatch = NULL;
+   psSlot->pvGame = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+int Mux_run(int iMaxGames, Mux_Start pfStart, Mux_Finish pfFinish,
+            void *pvExtra) {
+
+   struct epoll_event asEvents[MAX_EVENTS];
+   struct Slot *psSlots;
+   Match_T oMatch;
+   void *pvGame;
+   int iEpoll, iActive, iMore, iEvents, iSlot, iKey, iOver, i, iOk;
+
+   assert(iMaxGames > 0);
+   assert(pfStart != NULL);
+   assert(pfFinish != NULL);
+
+   iEpoll = epoll_create1(EPOLL_CLOEXEC);
+   if (iEpoll == -1) return 0;
+   psSlots = calloc((size_t)iMaxGames, sizeof(struct Slot));
+   if (psSlots == NULL) {
+      close(iEpoll);
+      return 0;
+   }
+
+   iActive = 0;
+   iMore = 1;
+   iOk = 1;
+   for (;;) {
+      /* Fill the free slots with new games. */
+      for (iSlot = 0; iMore == 1 && iSlot < iMaxGames; iSlot++) {
+         if (psSlots[iSlot].oMatch != NULL) continue;
+         oMatch = NULL;
+         pvGame = NULL;
+         iMore = pfStart(pvExtra, &oMatch, &pvGame);
+         if (iMore == 0) break;
+         psSlots[iSlot].pvGame = pvGame;
+         psSlots[iSlot].oMatch = oMatch;
+         if (oMatch == NULL) {
+            pfFinish(pvExtra, pvGame, NULL);
+            psSlots[iSlot].pvGame = NULL;
+            iSlot--;
+            continue;
+         }
+         iActive++;
+
+         /* A game that cannot be watched is cut short. */
+         if (watchMatch(iEpoll, oMatch, iSlot) == 0) {
+            endSlot(iEpoll, &psSlots[iSlot], pfFinish, pvExtra);
+            iActive--;
+         }
+      }
+      if (iActive == 0) break;
+
+      iEvents = epoll_wait(iEpoll, asEvents, MAX_EVENTS, -1);
+      if (iEvents == -1) {
+         if (errno == EINTR) continue;
+         iOk = 0;
+         break;
+      }
+
+      /* Play the moves that have arrived. A slot freed here is not
+         refilled until every event has been handled, so later events
+         for it are simply dropped. */
+      for (i = 0; i < iEvents; i++) {
+         iSlot = (int)(asEvents[i].data.u64 / KEYS);
+         iKey = (int)(asEvents[i].data.u64 % KEYS);
+         if (psSlots[iSlot].oMatch == NULL) continue;
+         oMatch = psSlots[iSlot].oMatch;
+         if (iKey == KEY_TIMER) iOver = Match_expire(oMatch);
+         else iOver = Match_read(oMatch, iKey + 1);
+         if (iOver == 1) {
+            endSlot(iEpoll, &psSlots[iSlot], pfFinish, pvExtra);
+            iActive--;
+         }
+      }
+   }
+
+   /* Only reached with games in progress if epoll failed. */
+   for (iSlot = 0; iSlot < iMaxGames; iSlot++)
+      if (psSlots[iSlot].oMatch != NULL)
+         endSlot(iEpoll, &psSlots[iSlot], pfFinish, pvExtra);
+   free(psSlots);
+   close(iEpoll);
+   return iOk;
+}
+/*--------------------------------------------------------------------*/
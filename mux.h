@@ -0,0 +1,31 @@
+/*--------------------------------------------------------------------*/
+/* mux.h                                                              */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef MUX_INCLUDED
+#define MUX_INCLUDED
+
+#include "match.h"
+
+/* Starts the next game, storing its match in *poMatch (NULL if its
+   players could not be started) and anything the caller wants back
+   with it in *ppvGame. pvExtra is the pointer given to Mux_run.
+   Returns 1 if a game was started and 0 if there are no more. */
+typedef int (*Mux_Start)(void *pvExtra, Match_T *poMatch,
+                         void **ppvGame);
+
+/* Called when the game pvGame is over, with its match oMatch, or NULL
+   if its players could not be started. oMatch is over and is freed
+   afterwards. */
+typedef void (*Mux_Finish)(void *pvExtra, void *pvGame, Match_T oMatch);
+
+/* Plays the games that pfStart starts until it has none left, keeping
+   up to iMaxGames of them going at once in the calling thread. It
+   waits for the pipes of all of their players and their timers with
+   epoll, plays every move as soon as it arrives and ends a game as
+   soon as a player runs out of time. pfFinish is called as each game
+   ends. Returns 1 if successful and 0 if epoll failed. */
+int Mux_run(int iMaxGames, Mux_Start pfStart, Mux_Finish pfFinish,
+            void *pvExtra);
+
+#endif
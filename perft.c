@@ -0,0 +1,345 @@
+/*--------------------------------------------------------------------*/
+/* perft.c                                                            */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for sysconf */
+#include <pthread.h>
+#include "board.h"
+#include "bitboard.h"
+#include "metrics.h"
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Number of tiles on the board. */
+enum {TILES = 64};
+
+/* Most moves made before the tree is split up between the threads.
+   Deep enough for a few thousand subtrees, so that threads that run
+   out of work have plenty to steal. */
+enum {SPLIT_PLIES = 5};
+
+/* Most threads. */
+enum {MAX_THREADS = 256};
+
+/*--------------------------------------------------------------------*/
+
+/* The number of leaves of the game tree from the initial position at
+   each depth, counting a pass as a move of its own and a finished
+   game as a leaf however few moves it took. */
+static const uint64_t auExpected[] = {
+   1, 4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284,
+   212258800, 1939886636, 18429641748, 184042084512, 1891832540064
+};
+
+/* A subtree of the game tree: the moves from the initial position to
+   it and how deep to count below it. */
+struct Task {
+   unsigned char aucMoves[SPLIT_PLIES];
+   int iMoves;
+   int iDepth;
+};
+
+/* The tasks of one thread, which it takes from the bottom while the
+   other threads steal from the top. */
+struct Deque {
+   int *piTasks;
+   int iTop;
+   int iBottom;
+
+   /* Guards iTop and iBottom. */
+   pthread_mutex_t sLock;
+};
+
+/* One count of the game tree. */
+struct Perft {
+   /* The subtrees, and how many there are. */
+   struct Task *psTasks;
+   int iTasks;
+
+   /* The leaves found while splitting the tree up. */
+   uint64_t uNodes;
+
+   /* The tasks of each thread, and how many threads there are. */
+   struct Deque *psDeques;
+   int iThreads;
+};
+
+/* One thread of a count. */
+struct Worker {
+   struct Perft *psPerft;
+   int iIndex;
+
+   /* The leaves it counted, and how many tasks it stole. */
+   uint64_t uNodes;
+   long lStolen;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns the number of leaves of the game tree iDepth moves deep
+   below oBoard. */
+
+static uint64_t countLeaves(Board_T oBoard, int iDepth) {
+
+   uint64_t uMoves, uNodes;
+   int player, iSquare;
+
+   if (iDepth == 0) return 1;
+   uMoves = Board_legalMoves(oBoard);
+
+   /* Every move is a leaf one move deep, finished game or not. */
+   if (iDepth == 1) return (uint64_t)Bitboard_count(uMoves);
+
+   player = Board_getPlayer(oBoard);
+   uNodes = 0;
+   for (iSquare = 0; iSquare < TILES; iSquare++) {
+      if ((uMoves & ((uint64_t)1 << iSquare)) == 0) continue;
+      Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+
+      /* A finished game is a leaf however deep it is. The same player
+         moves again if the other player has to pass, which counts as a
+         move. */
+      if (Board_draw(oBoard) == 0) uNodes++;
+      else if (Board_getPlayer(oBoard) == player) {
+         if (iDepth == 2) uNodes++;
+         else uNodes += countLeaves(oBoard, iDepth - 2);
+      }
+      else uNodes += countLeaves(oBoard, iDepth - 1);
+      Board_unmakeMove(oBoard);
+   }
+   return uNodes;
+}
+
+/*--------------------------------------------------------------------*/
+/* Adds a task for the subtree iDepth moves deep below oBoard, which
+   was reached by the moves of *psTask, to psPerft, or splits it up
+   further if fewer than iPlies moves were made. Returns 1 if
+   successful and 0 if there is not enough memory. */
+
+static int splitTree(struct Perft *psPerft, Board_T oBoard,
+                     struct Task *psTask, int iDepth, int iPlies) {
+
+   struct Task *psMore;
+   uint64_t uMoves;
+   int player, iSquare, iOk;
+
+   if (psTask->iMoves == iPlies || iDepth <= 2) {
+      /* Double the array of tasks when it is full, which is whenever
+         their number reaches a power of two. */
+      if ((psPerft->iTasks & (psPerft->iTasks - 1)) == 0) {
+         psMore = realloc(psPerft->psTasks,
+                          (size_t)(psPerft->iTasks * 2 + 1)
+                          * sizeof(struct Task));
+         if (psMore == NULL) return 0;
+         psPerft->psTasks = psMore;
+      }
+      psPerft->psTasks[psPerft->iTasks] = *psTask;
+      psPerft->psTasks[psPerft->iTasks].iDepth = iDepth;
+      psPerft->iTasks++;
+      return 1;
+   }
+
+   player = Board_getPlayer(oBoard);
+   uMoves = Board_legalMoves(oBoard);
+   iOk = 1;
+   for (iSquare = 0; iOk == 1 && iSquare < TILES; iSquare++) {
+      if ((uMoves & ((uint64_t)1 << iSquare)) == 0) continue;
+      Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+      psTask->aucMoves[psTask->iMoves++] = (unsigned char)iSquare;
+      if (Board_draw(oBoard) == 0) psPerft->uNodes++;
+      else if (Board_getPlayer(oBoard) == player)
+         iOk = splitTree(psPerft, oBoard, psTask, iDepth - 2, iPlies);
+      else
+         iOk = splitTree(psPerft, oBoard, psTask, iDepth - 1, iPlies);
+      psTask->iMoves--;
+      Board_unmakeMove(oBoard);
+   }
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+/* Takes a task for thread iIndex of psPerft: its own newest one, or
+   else the oldest one of another thread. Stores whether it was stolen
+   in *piStolen. Returns its number, or -1 if there are none left. */
+
+static int takeTask(struct Perft *psPerft, int iIndex, int *piStolen) {
+
+   struct Deque *psDeque;
+   int i, iTask;
+
+   iTask = -1;
+   *piStolen = 0;
+   for (i = 0; iTask == -1 && i < psPerft->iThreads; i++) {
+      psDeque = &psPerft->psDeques[(iIndex + i) % psPerft->iThreads];
+      pthread_mutex_lock(&psDeque->sLock);
+      if (psDeque->iTop < psDeque->iBottom) {
+         if (i == 0) iTask = psDeque->piTasks[--psDeque->iBottom];
+         else {
+            iTask = psDeque->piTasks[psDeque->iTop++];
+            *piStolen = 1;
+         }
+      }
+      pthread_mutex_unlock(&psDeque->sLock);
+   }
+   return iTask;
+}
+
+/*--------------------------------------------------------------------*/
+/* Counts the leaves of tasks of the count of the struct Worker
+   pvWorker until none are left. Returns NULL. */
+
+static void *countTasks(void *pvWorker) {
+
+   struct Worker *psWorker;
+   struct Task *psTask;
+   struct Board_Storage sBoard;
+   Board_T oBoard;
+   int iTask, iStolen, i;
+
+   psWorker = (struct Worker *)pvWorker;
+   oBoard = Board_initIn(&sBoard, 0, NULL);
+   for (;;) {
+      iTask = takeTask(psWorker->psPerft, psWorker->iIndex, &iStolen);
+      if (iTask == -1) break;
+      psWorker->lStolen += iStolen;
+
+      /* Play the moves to the subtree, count it and take them back.
+         Board_draw makes the passes on the way. */
+      psTask = &psWorker->psPerft->psTasks[iTask];
+      for (i = 0; i < psTask->iMoves; i++) {
+         Board_makeMove(oBoard, psTask->aucMoves[i] / SIZE,
+                        psTask->aucMoves[i] % SIZE);
+         Board_draw(oBoard);
+      }
+      psWorker->uNodes += countLeaves(oBoard, psTask->iDepth);
+      for (i = 0; i < psTask->iMoves; i++) Board_unmakeMove(oBoard);
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+/* Counts the leaves of the game tree iDepth moves deep from the
+   initial position with iThreads threads. Stores the number of tasks
+   stolen in *plStolen. Returns the count, or 0 if the threads cannot
+   be started. */
+
+static uint64_t countTree(int iDepth, int iThreads, long *plStolen) {
+
+   struct Perft sPerft;
+   struct Task sTask;
+   struct Worker asWorkers[MAX_THREADS];
+   pthread_t aiThreads[MAX_THREADS];
+   struct Deque *psDeque;
+   struct Board_Storage sBoard;
+   Board_T oBoard;
+   uint64_t uNodes;
+   int i, iStarted;
+
+   *plStolen = 0;
+   sPerft.psTasks = NULL;
+   sPerft.iTasks = 0;
+   sPerft.uNodes = 0;
+   sPerft.iThreads = iThreads;
+   sTask.iMoves = 0;
+   oBoard = Board_initIn(&sBoard, 0, NULL);
+   i = splitTree(&sPerft, oBoard, &sTask, iDepth, SPLIT_PLIES);
+   if (i == 0) {
+      free(sPerft.psTasks);
+      return 0;
+   }
+
+   /* Deal the tasks out in turn, so that each thread starts with
+      subtrees from all over the tree. */
+   sPerft.psDeques = calloc((size_t)iThreads, sizeof(struct Deque));
+   assert(sPerft.psDeques != NULL);
+   for (i = 0; i < iThreads; i++) {
+      sPerft.psDeques[i].piTasks =
+         malloc((size_t)(sPerft.iTasks / iThreads + 1) * sizeof(int));
+      assert(sPerft.psDeques[i].piTasks != NULL);
+      pthread_mutex_init(&sPerft.psDeques[i].sLock, NULL);
+   }
+   for (i = 0; i < sPerft.iTasks; i++) {
+      psDeque = &sPerft.psDeques[i % iThreads];
+      psDeque->piTasks[psDeque->iBottom++] = i;
+   }
+
+   for (iStarted = 0; iStarted < iThreads; iStarted++) {
+      asWorkers[iStarted].psPerft = &sPerft;
+      asWorkers[iStarted].iIndex = iStarted;
+      asWorkers[iStarted].uNodes = 0;
+      asWorkers[iStarted].lStolen = 0;
+      if (pthread_create(&aiThreads[iStarted], NULL, countTasks,
+                         &asWorkers[iStarted]) != 0) {
+         perror("pthread_create");
+         break;
+      }
+   }
+   uNodes = sPerft.uNodes;
+   for (i = 0; i < iStarted; i++) {
+      pthread_join(aiThreads[i], NULL);
+      uNodes += asWorkers[i].uNodes;
+      *plStolen += asWorkers[i].lStolen;
+   }
+   if (iStarted == 0) uNodes = 0;
+
+   for (i = 0; i < iThreads; i++) {
+      pthread_mutex_destroy(&sPerft.psDeques[i].sLock);
+      free(sPerft.psDeques[i].piTasks);
+   }
+   free(sPerft.psDeques);
+   free(sPerft.psTasks);
+   return uNodes;
+}
+
+/*--------------------------------------------------------------------*/
+/* Counts the leaves of the game tree from the initial position at
+   every depth up to the depth on the command line, with the number
+   of threads given by -threads or else one per processor, and checks
+   each count against the known one. Prints each count with its time
+   and leaves per second. argc is the command line argument count and
+   argv the arguments. Returns 0, or EXIT_FAILURE if a count is
+   wrong. */
+
+int main(int argc, char *argv[]) {
+
+   uint64_t uNodes;
+   long lStart, lTime, lStolen;
+   int iDepth, iMaxDepth, iThreads, iRet, i;
+   const char *pcCheck;
+
+   iThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   iMaxDepth = 0;
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+         iThreads = atoi(argv[++i]);
+      else iMaxDepth = atoi(argv[i]);
+   }
+   if (iMaxDepth < 1 || iThreads < 1 || iThreads > MAX_THREADS) {
+      fprintf(stderr, "Usage: %s [-threads n] depth\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   printf("%d threads, %s flips\n", iThreads, Bitboard_getFlipKernel());
+   iRet = 0;
+   for (iDepth = 1; iDepth <= iMaxDepth; iDepth++) {
+      lStart = Metrics_millis();
+      uNodes = countTree(iDepth, iThreads, &lStolen);
+      lTime = Metrics_millis() - lStart;
+
+      pcCheck = "unchecked";
+      if (iDepth < (int)(sizeof(auExpected) / sizeof(auExpected[0]))) {
+         pcCheck = "ok";
+         if (uNodes != auExpected[iDepth]) {
+            pcCheck = "WRONG";
+            iRet = EXIT_FAILURE;
+         }
+      }
+      printf("depth %2d: %15llu leaves %8.3f s %12.0f leaves/s "
+             "%6ld stolen %s\n", iDepth, (unsigned long long)uNodes,
+             lTime / 1000.0, lTime == 0 ? 0.0 : uNodes * 1000.0 / lTime,
+             lStolen, pcCheck);
+   }
+   return iRet;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,77 @@
+/*--------------------------------------------------------------------*/
+/* player.c                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#define _GNU_SOURCE 1 /* for pipe2 */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <assert.h>
+#include "player.h"
+
+/* The environment the children inherit. */
+extern char **environ;
+
+/*--------------------------------------------------------------------*/
+int Player_spawn(const char *pcPath, char *const apcArgv[],
+                 pid_t *piPid, int *piToChild, int *piFromChild) {
+
+   posix_spawn_file_actions_t sActions;
+   posix_spawnattr_t sAttributes;
+   sigset_t sDefault;
+   int aiToChild[2], aiFromChild[2];
+   int iError;
+
+   assert(pcPath != NULL);
+   assert(apcArgv != NULL);
+   assert(piPid != NULL);
+   assert(piToChild != NULL);
+   assert(piFromChild != NULL);
+
+   /* Every end is close-on-exec, so the child only keeps the two that
+      become its stdin and stdout, and the children of other games do
+      not hold each other's pipes open. */
+   if (pipe2(aiToChild, O_CLOEXEC) == -1) return 0;
+   if (pipe2(aiFromChild, O_CLOEXEC) == -1) {
+      close(aiToChild[0]);
+      close(aiToChild[1]);
+      return 0;
+   }
+
+   /* The referee ignores SIGPIPE, which a child would inherit. */
+   posix_spawn_file_actions_init(&sActions);
+   posix_spawnattr_init(&sAttributes);
+   sigemptyset(&sDefault);
+   sigaddset(&sDefault, SIGPIPE);
+   iError = posix_spawn_file_actions_adddup2(&sActions,
+                                             aiToChild[0], 0);
+   if (iError == 0)
+      iError = posix_spawn_file_actions_adddup2(&sActions,
+                                                aiFromChild[1], 1);
+   if (iError == 0)
+      iError = posix_spawnattr_setsigdefault(&sAttributes, &sDefault);
+   if (iError == 0)
+      iError = posix_spawnattr_setflags(&sAttributes,
+                                        POSIX_SPAWN_SETSIGDEF);
+   if (iError == 0)
+      iError = posix_spawn(piPid, pcPath, &sActions, &sAttributes,
+                           apcArgv, environ);
+   posix_spawnattr_destroy(&sAttributes);
+   posix_spawn_file_actions_destroy(&sActions);
+
+   /* Close the child's ends of the pipes. */
+   close(aiToChild[0]);
+   close(aiFromChild[1]);
+   if (iError != 0) {
+      close(aiToChild[1]);
+      close(aiFromChild[0]);
+      errno = iError;
+      return 0;
+   }
+   *piToChild = aiToChild[1];
+   *piFromChild = aiFromChild[0];
+   return 1;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,24 @@
+/*--------------------------------------------------------------------*/
+/* player.h                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef PLAYER_INCLUDED
+#define PLAYER_INCLUDED
+
+#include <sys/types.h>
+
+/* Starts the program pcPath as a child process with the arguments in
+   apcArgv, a NULL-terminated array that starts with the name of the
+   program, in one step with posix_spawn: no copy of this process is
+   made, however big it is. The child's stdin and stdout are pipes to
+   this process, SIGPIPE is back to its default in it, and it gets no
+   other descriptor of this process as long as they are all opened
+   close-on-exec, as the pipes are. Stores the process id of the child
+   in *piPid, the end of the pipe to its stdin in *piToChild and the
+   end of the pipe from its stdout in *piFromChild. Returns 1 if
+   successful, and 0 with errno set if the pipes cannot be made or the
+   program cannot be run. Safe to call from several threads at once. */
+int Player_spawn(const char *pcPath, char *const apcArgv[],
+                 pid_t *piPid, int *piToChild, int *piFromChild);
+
+#endif
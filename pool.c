@@ -0,0 +1,189 @@
+/*--------------------------------------------------------------------*/
+/* pool.c                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#define _GNU_SOURCE 1 /* for kill */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "pool.h"
+
+/*--------------------------------------------------------------------*/
+
+/* An idle process of a player. */
+struct Idle {
+   struct Pool_Process sProcess;
+   struct Idle *psNext;
+};
+
+/* A player that speaks the protocol, with its idle processes. */
+struct Member {
+   char *pcName;
+   struct Idle *psIdle;
+   struct Member *psNext;
+};
+
+struct Pool {
+   /* The players of the pool. */
+   struct Member *psMembers;
+
+   /* Guards everything above. */
+   pthread_mutex_t sLock;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns the member of oPool named player, or NULL if there is none.
+   The caller holds the lock of oPool. */
+
+static struct Member *findMember(Pool_T oPool, const char *player) {
+
+   struct Member *psMember;
+
+   for (psMember = oPool->psMembers; psMember != NULL;
+        psMember = psMember->psNext)
+      if (strcmp(psMember->pcName, player) == 0) return psMember;
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+Pool_T Pool_new(void) {
+
+   Pool_T oPool;
+
+   oPool = (Pool_T)calloc(1, sizeof(struct Pool));
+   if (oPool == NULL) return NULL;
+   pthread_mutex_init(&oPool->sLock, NULL);
+   return oPool;
+}
+
+/*--------------------------------------------------------------------*/
+void Pool_free(Pool_T oPool) {
+
+   struct Member *psMember;
+   struct Idle *psIdle;
+
+   assert(oPool != NULL);
+
+   while (oPool->psMembers != NULL) {
+      psMember = oPool->psMembers;
+      oPool->psMembers = psMember->psNext;
+      while (psMember->psIdle != NULL) {
+         psIdle = psMember->psIdle;
+         psMember->psIdle = psIdle->psNext;
+         Pool_stop(&psIdle->sProcess);
+         free(psIdle);
+      }
+      free(psMember->pcName);
+      free(psMember);
+   }
+   pthread_mutex_destroy(&oPool->sLock);
+   free(oPool);
+}
+
+/*--------------------------------------------------------------------*/
+void Pool_addPlayer(Pool_T oPool, const char *player) {
+
+   struct Member *psMember;
+
+   assert(oPool != NULL);
+   assert(player != NULL);
+
+   pthread_mutex_lock(&oPool->sLock);
+   if (findMember(oPool, player) == NULL) {
+      psMember = calloc(1, sizeof(struct Member));
+      assert(psMember != NULL);
+      psMember->pcName = malloc(strlen(player) + 1);
+      assert(psMember->pcName != NULL);
+      strcpy(psMember->pcName, player);
+      psMember->psNext = oPool->psMembers;
+      oPool->psMembers = psMember;
+   }
+   pthread_mutex_unlock(&oPool->sLock);
+}
+
+/*--------------------------------------------------------------------*/
+int Pool_isPooled(Pool_T oPool, const char *player) {
+
+   int iPooled;
+
+   assert(oPool != NULL);
+   assert(player != NULL);
+
+   pthread_mutex_lock(&oPool->sLock);
+   iPooled = (findMember(oPool, player) != NULL);
+   pthread_mutex_unlock(&oPool->sLock);
+   return iPooled;
+}
+
+/*--------------------------------------------------------------------*/
+int Pool_take(Pool_T oPool, const char *player,
+              struct Pool_Process *psProcess) {
+
+   struct Member *psMember;
+   struct Idle *psIdle;
+
+   assert(oPool != NULL);
+   assert(player != NULL);
+   assert(psProcess != NULL);
+
+   pthread_mutex_lock(&oPool->sLock);
+   psMember = findMember(oPool, player);
+   psIdle = NULL;
+   if (psMember != NULL && psMember->psIdle != NULL) {
+      psIdle = psMember->psIdle;
+      psMember->psIdle = psIdle->psNext;
+   }
+   pthread_mutex_unlock(&oPool->sLock);
+
+   if (psIdle == NULL) return 0;
+   *psProcess = psIdle->sProcess;
+   free(psIdle);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+void Pool_give(Pool_T oPool, const char *player,
+               const struct Pool_Process *psProcess) {
+
+   struct Member *psMember;
+   struct Idle *psIdle;
+
+   assert(oPool != NULL);
+   assert(player != NULL);
+   assert(psProcess != NULL);
+
+   psIdle = malloc(sizeof(struct Idle));
+   if (psIdle == NULL) {
+      Pool_stop(psProcess);
+      return;
+   }
+   psIdle->sProcess = *psProcess;
+
+   pthread_mutex_lock(&oPool->sLock);
+   psMember = findMember(oPool, player);
+   if (psMember != NULL) {
+      psIdle->psNext = psMember->psIdle;
+      psMember->psIdle = psIdle;
+   }
+   pthread_mutex_unlock(&oPool->sLock);
+
+   if (psMember == NULL) {
+      Pool_stop(psProcess);
+      free(psIdle);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+void Pool_stop(const struct Pool_Process *psProcess) {
+
+   assert(psProcess != NULL);
+   close(psProcess->iToChild);
+   close(psProcess->iFromChild);
+   kill(psProcess->iPid, SIGKILL);
+   waitpid(psProcess->iPid, NULL, 0);
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,75 @@
+/*--------------------------------------------------------------------*/
+/* pool.h                                                             */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef POOL_INCLUDED
+#define POOL_INCLUDED
+
+#include <sys/types.h>
+
+/* A Pool keeps player processes alive between games so that they can
+   be used again instead of being started from scratch. Only players
+   added with Pool_addPlayer are pooled: they are started with the
+   argument "POOL" instead of FIRST or SECOND and speak this protocol
+   on their stdin and stdout:
+
+      referee: NEWGAME FIRST      (or NEWGAME SECOND) starts a game
+      ...                         the moves of the game, as usual
+      referee: ENDGAME            the game is over
+      player:  ENDGAME            the player is ready for the next one
+
+   The referee throws away whatever a player writes before its
+   ENDGAME, so a player that was still busy with the last game does
+   not confuse the next one. Any number of threads can use the same
+   Pool at once. */
+
+typedef struct Pool *Pool_T;
+
+/* A running player process. */
+struct Pool_Process {
+   /* The process id of the player. */
+   pid_t iPid;
+
+   /* The pipe its moves are read from. */
+   int iFromChild;
+
+   /* The pipe its stdin is written to. */
+   int iToChild;
+
+   /* The number of ENDGAME lines sent to it that it has not answered
+      yet. */
+   int iPending;
+
+   /* Whether it was offered the binary protocol of protocol.h, and
+      whether it has accepted it so far. */
+   int iBinary;
+   int iHello;
+};
+
+/* Returns a new empty Pool, or NULL if there is not enough memory. */
+Pool_T Pool_new(void);
+
+/* Stops every process in oPool and frees it. */
+void Pool_free(Pool_T oPool);
+
+/* Marks the player file player as one that speaks the protocol of
+   oPool. */
+void Pool_addPlayer(Pool_T oPool, const char *player);
+
+/* Returns 1 if player was added to oPool and 0 if not. */
+int Pool_isPooled(Pool_T oPool, const char *player);
+
+/* Takes an idle process of the player file player out of oPool and
+   stores it in *psProcess. Returns 1 if there was one and 0 if not. */
+int Pool_take(Pool_T oPool, const char *player,
+              struct Pool_Process *psProcess);
+
+/* Puts the process *psProcess of the player file player, which has
+   been sent ENDGAME, back into oPool. */
+void Pool_give(Pool_T oPool, const char *player,
+               const struct Pool_Process *psProcess);
+
+/* Closes the pipes of *psProcess, kills it and waits for it to exit. */
+void Pool_stop(const struct Pool_Process *psProcess);
+
+#endif
@@ -0,0 +1,67 @@
+/*--------------------------------------------------------------------*/
+/* protocol.h                                                         */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef PROTOCOL_INCLUDED
+#define PROTOCOL_INCLUDED
+
+#include <string.h>
+
+/* The binary move protocol is a faster way for the referee and a
+   player to exchange moves than lines of text, which has to be
+   offered by the referee and accepted by the player. The referee
+   offers it by starting the player with "BINARY" as a second
+   argument, after FIRST, SECOND or POOL. A player that accepts writes
+   the PROTOCOL_FRAME bytes of acProtocolHello before anything else,
+   and from then on both sides send each move as a frame of
+   PROTOCOL_FRAME bytes, with plain read and write calls:
+
+      0  the square of the move, row * 8 + column
+      1  flags: PROTOCOL_PASS in a frame from the referee if the
+         player it is sent to has to pass after the move
+      2  the sequence number of the move, the number of moves made in
+         the game before it, passes not counted, as two bytes, least
+         significant first
+
+   Passes are never sent, as in the text protocol. A player that does
+   not accept ignores the argument and plays with text, which the
+   referee then takes as a bad move. The lines of the protocol of a
+   Pool (NEWGAME and ENDGAME) stay text; they cannot be taken for a
+   frame, as no square is a letter. */
+
+/* Bytes of a frame. */
+enum {PROTOCOL_FRAME = 4};
+
+/* The flag of a frame after which its receiver has to pass. */
+enum {PROTOCOL_PASS = 1};
+
+/* The frame a player accepts the binary protocol with. */
+static const char acProtocolHello[PROTOCOL_FRAME] = {'O', 'T', 'H', 'P'};
+
+/* Fills the frame pucFrame with the move to iSquare (row * 8 +
+   column), the flags iFlags and the sequence number iSequence. */
+static inline void Protocol_pack(unsigned char *pucFrame, int iSquare,
+                                 int iFlags, int iSequence) {
+   pucFrame[0] = (unsigned char)iSquare;
+   pucFrame[1] = (unsigned char)iFlags;
+   pucFrame[2] = (unsigned char)(iSequence & 0xFF);
+   pucFrame[3] = (unsigned char)((iSequence >> 8) & 0xFF);
+}
+
+/* Reads the frame pucFrame into *piSquare, *piFlags and *piSequence.
+   Returns 1 if it is a move to a square of the board and 0 if not. */
+static inline int Protocol_unpack(const unsigned char *pucFrame,
+                                  int *piSquare, int *piFlags,
+                                  int *piSequence) {
+   *piSquare = pucFrame[0];
+   *piFlags = pucFrame[1];
+   *piSequence = pucFrame[2] | (pucFrame[3] << 8);
+   return *piSquare < 64;
+}
+
+/* Returns 1 if the frame pucFrame is the hello frame and 0 if not. */
+static inline int Protocol_isHello(const unsigned char *pucFrame) {
+   return memcmp(pucFrame, acProtocolHello, PROTOCOL_FRAME) == 0;
+}
+
+#endif
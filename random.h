@@ -0,0 +1,43 @@
+/*--------------------------------------------------------------------*/
+/* random.h                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef RANDOM_INCLUDED
+#define RANDOM_INCLUDED
+
+#include <stdint.h>
+#include "bitboard.h"
+
+/* A small random number generator (xorshift64*) for the tools that
+   play random moves. Its whole state is one uint64_t of the caller's,
+   so every game or thread can have its own sequence, and the same
+   seed always gives the same sequence. */
+
+/* Returns the state of the sequence numbered uIndex. Different
+   indexes give different sequences. */
+static inline uint64_t Random_seed(uint64_t uIndex) {
+   /* Any state but 0 will do for xorshift. */
+   return (uIndex + 1) * 0x9E3779B97F4A7C15ULL;
+}
+
+/* Returns the next number of the sequence with the state *puState. */
+static inline uint64_t Random_next(uint64_t *puState) {
+   *puState ^= *puState >> 12;
+   *puState ^= *puState << 25;
+   *puState ^= *puState >> 27;
+   return *puState * 0x2545F4914F6CDD1DULL;
+}
+
+/* Returns a tile (row * 8 + column) of the bitboard uMoves, which must
+   not be 0, picked at random with the state *puState. */
+static inline int Random_pick(uint64_t uMoves, uint64_t *puState) {
+
+   int iPick;
+
+   iPick = (int)(Random_next(puState)
+                 % (uint64_t)Bitboard_count(uMoves));
+   while (iPick-- > 0) uMoves &= uMoves - 1;
+   return Bitboard_first(uMoves);
+}
+
+#endif
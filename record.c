@@ -0,0 +1,480 @@
+/*--------------------------------------------------------------------*/
+/* record.c                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#define _GNU_SOURCE 1 /* for O_CLOEXEC and flock */
+#include <errno.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include "record.h"
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* The version of the record format. */
+enum {VERSION = 1};
+
+/* Bytes of the buffer of a Record_T. Records are small, so a big
+   buffer turns thousands of them into one write. */
+enum {BUFFER_SIZE = 1 << 20};
+
+/* Most records the buffer can hold: no record is shorter than its
+   header. */
+enum {BUFFER_RECORDS = BUFFER_SIZE / RECORD_HEADER};
+
+/* What is added to the name of an archive for the name of its
+   index. */
+static const char acIndexSuffix[] = ".idx";
+
+/* The first bytes of every record. */
+static const unsigned char aucMagic[4] = {'O', 'T', 'H', 'R'};
+
+/*--------------------------------------------------------------------*/
+
+struct Record {
+   /* The archive the records are appended to, and its index, opened
+      for appending. */
+   int iFile;
+   int iIndex;
+
+   /* The records that are not written yet, one after another, and
+      their index entries, whose offsets count from the start of
+      pucBuffer until they are written. */
+   unsigned char *pucBuffer;
+   size_t ulBuffered;
+   struct Record_Index *psEntries;
+   size_t ulEntries;
+
+   /* Guards everything above. */
+   pthread_mutex_t sLock;
+};
+
+/*--------------------------------------------------------------------*/
+/* Copies the name pcName to pcCopy, which holds RECORD_MAX_NAME
+   characters and the null character, cutting it short if needed. */
+
+static void copyName(char *pcCopy, const char *pcName) {
+   strncpy(pcCopy, pcName, RECORD_MAX_NAME);
+   pcCopy[RECORD_MAX_NAME] = '\0';
+}
+
+/*--------------------------------------------------------------------*/
+void Record_start(struct Record_Game *psGame, const char *player1,
+                  const char *player2) {
+
+   assert(psGame != NULL);
+   assert(player1 != NULL);
+   assert(player2 != NULL);
+
+   copyName(psGame->acPlayer1, player1);
+   copyName(psGame->acPlayer2, player2);
+   psGame->iEnd = RECORD_FINISHED;
+   psGame->iScore = 0;
+   psGame->cBadColumn = ' ';
+   psGame->iBadRow = -1;
+   psGame->iMoves = 0;
+}
+
+/*--------------------------------------------------------------------*/
+void Record_addMove(struct Record_Game *psGame, int row, int column) {
+
+   assert(psGame != NULL);
+   assert(psGame->iMoves < RECORD_MAX_MOVES);
+
+   if (row == -1) psGame->aucMoves[psGame->iMoves++] = RECORD_PASS;
+   else psGame->aucMoves[psGame->iMoves++] =
+           (unsigned char)(row * SIZE + column);
+}
+
+/*--------------------------------------------------------------------*/
+size_t Record_encode(const struct Record_Game *psGame,
+                     unsigned char *pucRecord) {
+
+   size_t ulLength1, ulLength2;
+   unsigned long ulRow;
+
+   assert(psGame != NULL);
+   assert(pucRecord != NULL);
+
+   ulLength1 = strlen(psGame->acPlayer1);
+   ulLength2 = strlen(psGame->acPlayer2);
+   ulRow = (unsigned long)psGame->iBadRow;
+
+   memcpy(pucRecord, aucMagic, sizeof(aucMagic));
+   pucRecord[4] = VERSION;
+   pucRecord[5] = (unsigned char)psGame->iEnd;
+   pucRecord[6] = (unsigned char)(signed char)psGame->iScore;
+   pucRecord[7] = (unsigned char)psGame->iMoves;
+   pucRecord[8] = (unsigned char)ulLength1;
+   pucRecord[9] = (unsigned char)ulLength2;
+   pucRecord[10] = (unsigned char)psGame->cBadColumn;
+   pucRecord[11] = (unsigned char)(ulRow & 0xff);
+   pucRecord[12] = (unsigned char)((ulRow >> 8) & 0xff);
+   pucRecord[13] = (unsigned char)((ulRow >> 16) & 0xff);
+   pucRecord[14] = (unsigned char)((ulRow >> 24) & 0xff);
+   memcpy(pucRecord + RECORD_HEADER, psGame->acPlayer1, ulLength1);
+   memcpy(pucRecord + RECORD_HEADER + ulLength1, psGame->acPlayer2,
+          ulLength2);
+   memcpy(pucRecord + RECORD_HEADER + ulLength1 + ulLength2,
+          psGame->aucMoves, (size_t)psGame->iMoves);
+   return RECORD_HEADER + ulLength1 + ulLength2 + (size_t)psGame->iMoves;
+}
+
+/*--------------------------------------------------------------------*/
+size_t Record_decode(const unsigned char *pucRecord, size_t ulSize,
+                     struct Record_Game *psGame) {
+
+   size_t ulLength1, ulLength2, ulLength;
+   unsigned long ulRow;
+   int i;
+
+   assert(pucRecord != NULL);
+   assert(psGame != NULL);
+
+   if (ulSize < RECORD_HEADER
+       || memcmp(pucRecord, aucMagic, sizeof(aucMagic)) != 0
+       || pucRecord[4] != VERSION || pucRecord[5] > RECORD_BAD_MOVE
+       || pucRecord[7] > RECORD_MAX_MOVES)
+      return 0;
+   ulLength1 = pucRecord[8];
+   ulLength2 = pucRecord[9];
+   ulLength = RECORD_HEADER + ulLength1 + ulLength2 + pucRecord[7];
+   if (ulSize < ulLength) return 0;
+
+   psGame->iEnd = pucRecord[5];
+   psGame->iScore = (signed char)pucRecord[6];
+   psGame->iMoves = pucRecord[7];
+   psGame->cBadColumn = (char)pucRecord[10];
+
+   ulRow = (unsigned long)pucRecord[11]
+      | ((unsigned long)pucRecord[12] << 8)
+      | ((unsigned long)pucRecord[13] << 16)
+      | ((unsigned long)pucRecord[14] << 24);
+   psGame->iBadRow = (int)(int32_t)(uint32_t)ulRow;
+
+   memcpy(psGame->acPlayer1, pucRecord + RECORD_HEADER, ulLength1);
+   psGame->acPlayer1[ulLength1] = '\0';
+   memcpy(psGame->acPlayer2, pucRecord + RECORD_HEADER + ulLength1,
+          ulLength2);
+   psGame->acPlayer2[ulLength2] = '\0';
+   memcpy(psGame->aucMoves, pucRecord + RECORD_HEADER + ulLength1
+          + ulLength2, (size_t)psGame->iMoves);
+   for (i = 0; i < psGame->iMoves; i++)
+      if (psGame->aucMoves[i] > RECORD_PASS) return 0;
+   return ulLength;
+}
+
+/*--------------------------------------------------------------------*/
+uint32_t Record_hashName(const char *pcName) {
+
+   uint32_t uHash;
+
+   assert(pcName != NULL);
+
+   /* FNV-1a. */
+   uHash = 2166136261u;
+   while (*pcName != '\0') {
+      uHash ^= (unsigned char)*pcName++;
+      uHash *= 16777619u;
+   }
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+void Record_makeIndex(const struct Record_Game *psGame,
+                      unsigned long ulOffset, size_t ulLength,
+                      struct Record_Index *psIndex) {
+
+   assert(psGame != NULL);
+   assert(psIndex != NULL);
+
+   memset(psIndex, 0, sizeof(struct Record_Index));
+   psIndex->uOffset = ulOffset;
+   psIndex->uPlayer1 = Record_hashName(psGame->acPlayer1);
+   psIndex->uPlayer2 = Record_hashName(psGame->acPlayer2);
+   psIndex->uLength = (uint16_t)ulLength;
+   psIndex->iScore = (int8_t)psGame->iScore;
+   psIndex->uEnd = (uint8_t)psGame->iEnd;
+   psIndex->uMoves = (uint8_t)psGame->iMoves;
+}
+
+/*--------------------------------------------------------------------*/
+char *Record_indexName(const char *pcFile) {
+
+   char *pcIndex;
+
+   assert(pcFile != NULL);
+
+   pcIndex = malloc(strlen(pcFile) + sizeof(acIndexSuffix));
+   if (pcIndex == NULL) return NULL;
+   strcpy(pcIndex, pcFile);
+   strcat(pcIndex, acIndexSuffix);
+   return pcIndex;
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the ulLength bytes at pvData to the file iFd. Returns 1 if
+   successful and 0 if not. */
+
+static int writeAll(int iFd, const void *pvData, size_t ulLength) {
+
+   const unsigned char *pucData;
+   ssize_t lWritten;
+
+   pucData = pvData;
+   while (ulLength > 0) {
+      lWritten = write(iFd, pucData, ulLength);
+      if (lWritten == -1) {
+         if (errno == EINTR) continue;
+         return 0;
+      }
+      pucData += lWritten;
+      ulLength -= (size_t)lWritten;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Appends the records in the buffer of oRecord to its archive and
+   their entries to its index, and empties the buffer. The caller
+   holds the lock of oRecord. Returns 1 if successful and 0 if not. */
+
+static int flushRecords(Record_T oRecord) {
+
+   off_t lEnd;
+   size_t i;
+   int iOk;
+
+   if (oRecord->ulEntries == 0) return 1;
+
+   /* Referees in other processes may be appending to the same
+      archive. Under the lock of the archive, which they take too, the
+      end of the archive is where these records will go, and the index
+      entries go in the same order as the records. */
+   while (flock(oRecord->iFile, LOCK_EX) == -1)
+      if (errno != EINTR) return 0;
+   lEnd = lseek(oRecord->iFile, 0, SEEK_END);
+   iOk = (lEnd != -1);
+   if (iOk == 1) {
+      for (i = 0; i < oRecord->ulEntries; i++)
+         oRecord->psEntries[i].uOffset += (uint64_t)lEnd;
+      iOk = writeAll(oRecord->iFile, oRecord->pucBuffer,
+                     oRecord->ulBuffered)
+         && writeAll(oRecord->iIndex, oRecord->psEntries,
+                     oRecord->ulEntries * sizeof(struct Record_Index));
+   }
+   flock(oRecord->iFile, LOCK_UN);
+   oRecord->ulBuffered = 0;
+   oRecord->ulEntries = 0;
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+Record_T Record_open(const char *pcFile) {
+
+   Record_T oRecord;
+   char *pcIndex;
+
+   assert(pcFile != NULL);
+
+   oRecord = (Record_T)calloc(1, sizeof(struct Record));
+   if (oRecord == NULL) return NULL;
+   pcIndex = Record_indexName(pcFile);
+   oRecord->pucBuffer = malloc(BUFFER_SIZE);
+   oRecord->psEntries = malloc(BUFFER_RECORDS
+                               * sizeof(struct Record_Index));
+   oRecord->iFile = open(pcFile, O_WRONLY | O_CREAT | O_APPEND
+                         | O_CLOEXEC, 0666);
+   oRecord->iIndex = -1;
+   if (pcIndex != NULL)
+      oRecord->iIndex = open(pcIndex, O_WRONLY | O_CREAT | O_APPEND
+                             | O_CLOEXEC, 0666);
+   free(pcIndex);
+   if (oRecord->pucBuffer == NULL || oRecord->psEntries == NULL
+       || oRecord->iFile == -1 || oRecord->iIndex == -1) {
+      if (oRecord->iFile != -1) close(oRecord->iFile);
+      if (oRecord->iIndex != -1) close(oRecord->iIndex);
+      free(oRecord->pucBuffer);
+      free(oRecord->psEntries);
+      free(oRecord);
+      return NULL;
+   }
+   pthread_mutex_init(&oRecord->sLock, NULL);
+   return oRecord;
+}
+
+/*--------------------------------------------------------------------*/
+int Record_write(Record_T oRecord, const struct Record_Game *psGame) {
+
+   unsigned char aucRecord[RECORD_MAX_SIZE];
+   size_t ulLength;
+   int iOk;
+
+   assert(oRecord != NULL);
+   assert(psGame != NULL);
+
+   ulLength = Record_encode(psGame, aucRecord);
+   pthread_mutex_lock(&oRecord->sLock);
+   iOk = 1;
+   if (oRecord->ulBuffered + ulLength > BUFFER_SIZE)
+      iOk = flushRecords(oRecord);
+   Record_makeIndex(psGame, (unsigned long)oRecord->ulBuffered, ulLength,
+                    &oRecord->psEntries[oRecord->ulEntries++]);
+   memcpy(oRecord->pucBuffer + oRecord->ulBuffered, aucRecord, ulLength);
+   oRecord->ulBuffered += ulLength;
+   pthread_mutex_unlock(&oRecord->sLock);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+int Record_close(Record_T oRecord) {
+
+   int iOk;
+
+   assert(oRecord != NULL);
+
+   iOk = flushRecords(oRecord);
+   if (close(oRecord->iFile) != 0) iOk = 0;
+   if (close(oRecord->iIndex) != 0) iOk = 0;
+   pthread_mutex_destroy(&oRecord->sLock);
+   free(oRecord->pucBuffer);
+   free(oRecord->psEntries);
+   free(oRecord);
+   return iOk;
+}
+
+/*--------------------------------------------------------------------*/
+void Record_printStart(Board_T oBoard, FILE *psFile) {
+
+   int row;
+   int column;
+
+   assert(oBoard != NULL);
+   assert(psFile != NULL);
+
+   fprintf(psFile, "\nInitial game state:\n");
+   fprintf(psFile, "FIRST = x, SECOND = o\n\n");
+   fprintf(psFile, "   A B C D E F G H\n");
+
+   for (column = 0; column < SIZE; column++) {
+      fprintf(psFile, "%d ", column);
+      for (row = 0; row < SIZE; row++) {
+         fprintf(psFile, " %c", Board_getSymbol(oBoard, row, column));
+      }
+      fprintf(psFile, "\n");
+   }
+   fprintf(psFile, "\n");
+}
+
+/*--------------------------------------------------------------------*/
+void Record_printMove(Board_T oBoard, int row, char column, int count,
+                      FILE *psFile) {
+
+   assert(oBoard != NULL);
+   assert(psFile != NULL);
+
+   if (Board_getPlayer(oBoard) == 1) {
+      fprintf(psFile, "Move #%d (by FIRST player): %c%d\n", count,
+              column, row);
+   }
+   else {
+      fprintf(psFile, "Move #%d (by SECOND player): %c%d\n", count,
+              column, row);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+int Record_printDraw(Board_T oBoard, FILE *psFile) {
+
+   assert(oBoard != NULL);
+   assert(psFile != NULL);
+
+   fprintf(psFile, "\nCurrent game state:\n");
+   fprintf(psFile, "FIRST = x, SECOND = o\n\n");
+   fprintf(psFile, "   A B C D E F G H\n");
+   return Board_draw(oBoard);
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays the moves of *psGame on oBoard, writing them to psFile as the
+   tracking text does unless psFile is NULL. Returns 1 if they are a
+   game, with passes where a player had to pass, that ends where
+   *psGame says it does, and 0 if not. */
+
+static int replayGame(const struct Record_Game *psGame, Board_T oBoard,
+                      FILE *psFile) {
+
+   int i, row, column, player, count, iOver;
+
+   count = 0;
+   iOver = 0;
+   for (i = 0; i < psGame->iMoves; i++) {
+      if (iOver == 1 || psGame->aucMoves[i] == RECORD_PASS) return 0;
+      row = psGame->aucMoves[i] / SIZE;
+      column = psGame->aucMoves[i] % SIZE;
+      if (Board_moveIsValid(oBoard, row, column) == 0) return 0;
+
+      player = Board_getPlayer(oBoard);
+      if (psFile != NULL)
+         Record_printMove(oBoard, row, (char)('A' + column), count,
+                          psFile);
+      Board_makeMove(oBoard, row, column);
+      if (psFile != NULL) iOver = (Record_printDraw(oBoard, psFile) == 0);
+      else iOver = (Board_draw(oBoard) == 0);
+      count++;
+
+      /* The other player passed. */
+      if (iOver == 0 && Board_getPlayer(oBoard) == player) {
+         if (i + 1 == psGame->iMoves
+             || psGame->aucMoves[i + 1] != RECORD_PASS)
+            return 0;
+         i++;
+      }
+   }
+   return iOver == (psGame->iEnd == RECORD_FINISHED);
+}
+
+/*--------------------------------------------------------------------*/
+int Record_printText(const struct Record_Game *psGame, FILE *psFile) {
+
+   struct Board_Storage sBoard;
+   Board_T oBoard;
+   char *player1, *player2;
+   int iValid, count, i;
+
+   assert(psGame != NULL);
+   assert(psFile != NULL);
+
+   /* Make sure the record is a game before writing any of it. */
+   oBoard = Board_initIn(&sBoard, 0, NULL);
+   iValid = replayGame(psGame, oBoard, NULL);
+   if (iValid == 0) {
+      fclose(psFile);
+      return 0;
+   }
+
+   /* Board_endGame takes names that are not const. */
+   player1 = (char *)psGame->acPlayer1;
+   player2 = (char *)psGame->acPlayer2;
+
+   oBoard = Board_initIn(&sBoard, 1, psFile);
+   Record_printStart(oBoard, psFile);
+   (void)replayGame(psGame, oBoard, psFile);
+   if (psGame->iEnd == RECORD_FINISHED) {
+      Board_endGame(oBoard, player1, player2);
+      return 1;
+   }
+
+   if (psGame->iEnd == RECORD_BAD_MOVE) {
+      for (i = 0, count = 0; i < psGame->iMoves; i++)
+         if (psGame->aucMoves[i] != RECORD_PASS) count++;
+      Record_printMove(oBoard, psGame->iBadRow, psGame->cBadColumn, count,
+                       psFile);
+      Board_endGameBad(oBoard, player1, player2, 0);
+   }
+   else if (psGame->iEnd == RECORD_CRASHED)
+      Board_endGameBad(oBoard, player1, player2, 1);
+   else Board_endGameBad(oBoard, player1, player2, 2);
+   return 1;
+}
+/*--------------------------------------------------------------------*/
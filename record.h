@@ -0,0 +1,171 @@
+/*--------------------------------------------------------------------*/
+/* record.h                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef RECORD_INCLUDED
+#define RECORD_INCLUDED
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+
+/* A game record is a game of othello kept in a few dozen bytes
+   instead of the tracking text, which can be written out again from
+   it. A record is a header of RECORD_HEADER bytes:
+
+      0  "OTHR"
+      4  the version, 1
+      5  how the game ended, an enum Record_End
+      6  the score, FIRST's tiles minus SECOND's, as a signed byte
+      7  the number of moves, passes included
+      8  the lengths of the names of FIRST and SECOND
+     10  the column letter and the row of a bad move, the row as four
+         bytes, least significant first
+
+   followed by the names of FIRST and SECOND and then one byte per
+   move: row * 8 + column, or RECORD_PASS where a player had to pass.
+   Records are appended one after another to an archive file through a
+   Record_T, which also appends a struct Record_Index for each of them
+   to an index file next to it, named like the archive with ".idx"
+   added. */
+
+/* How a game ended: with neither player able to move, with the
+   player to move crashing, running out of time or making a bad
+   move. */
+enum Record_End {RECORD_FINISHED, RECORD_CRASHED, RECORD_TIMED_OUT,
+                 RECORD_BAD_MOVE};
+
+/* The move byte of a pass. */
+enum {RECORD_PASS = 64};
+
+/* Bytes of the header of a record. */
+enum {RECORD_HEADER = 15};
+
+/* Longest name of a player, and most moves of a game, passes
+   included. */
+enum {RECORD_MAX_NAME = 255, RECORD_MAX_MOVES = 128};
+
+/* Longest record. */
+enum {RECORD_MAX_SIZE = RECORD_HEADER + 2 * RECORD_MAX_NAME
+      + RECORD_MAX_MOVES};
+
+/* A game, as written to and read from a record. */
+struct Record_Game {
+   /* The names of FIRST and SECOND. */
+   char acPlayer1[RECORD_MAX_NAME + 1];
+   char acPlayer2[RECORD_MAX_NAME + 1];
+
+   /* How the game ended, an enum Record_End, and its score. */
+   int iEnd;
+   int iScore;
+
+   /* The bad move as the player wrote it, if the game ended with
+      one. iBadRow is -1 if the player wrote no row. */
+   char cBadColumn;
+   int iBadRow;
+
+   /* The moves. */
+   int iMoves;
+   unsigned char aucMoves[RECORD_MAX_MOVES];
+};
+
+/* An entry of the index of an archive, which finds a record without
+   reading the ones before it. Entries are kept in the byte order of
+   the machine and are all the same size, so the index can be mapped
+   into memory and used as an array. */
+struct Record_Index {
+   /* Where the record starts in the archive. */
+   uint64_t uOffset;
+
+   /* The hashes of the names of FIRST and SECOND, see
+      Record_hashName. */
+   uint32_t uPlayer1;
+   uint32_t uPlayer2;
+
+   /* The length of the record. */
+   uint16_t uLength;
+
+   /* The score, how the game ended and the number of moves. */
+   int8_t iScore;
+   uint8_t uEnd;
+   uint8_t uMoves;
+
+   uint8_t aucUnused[3];
+};
+
+/* A file that game records are appended to, with its index. */
+typedef struct Record *Record_T;
+
+/* Returns the hash of the name of the player pcName that the index of
+   an archive keeps. */
+uint32_t Record_hashName(const char *pcName);
+
+/* Returns the name of the index of the archive pcFile, which the
+   caller frees, or NULL if there is not enough memory. */
+char *Record_indexName(const char *pcFile);
+
+/* Sets *psGame up for a game between player1 (FIRST) and player2
+   (SECOND) with no moves yet. Longer names are cut short. */
+void Record_start(struct Record_Game *psGame, const char *player1,
+                  const char *player2);
+
+/* Adds the move to row and column to *psGame, or a pass if row is
+   -1. */
+void Record_addMove(struct Record_Game *psGame, int row, int column);
+
+/* Stores *psGame in pucRecord, which must hold RECORD_MAX_SIZE bytes.
+   Returns the length of the record. */
+size_t Record_encode(const struct Record_Game *psGame,
+                     unsigned char *pucRecord);
+
+/* Reads the record at the start of the ulSize bytes at pucRecord into
+   *psGame. Returns the length of the record, or 0 if the bytes do not
+   start with a whole, valid record. */
+size_t Record_decode(const unsigned char *pucRecord, size_t ulSize,
+                     struct Record_Game *psGame);
+
+/* Opens the archive pcFile and its index for records to be appended
+   to, and creates them if they do not exist. Returns it, or NULL if
+   they cannot be opened. Several processes can each open the same
+   archive: records are buffered and written with their index entries
+   under an exclusive flock of the archive, so the entries of each
+   find their records. */
+Record_T Record_open(const char *pcFile);
+
+/* Appends the record of *psGame to oRecord, and its entry to the
+   index. Any number of threads can write to the same oRecord at once.
+   Returns 1 if successful and 0 if not. */
+int Record_write(Record_T oRecord, const struct Record_Game *psGame);
+
+/* Writes what is left in the buffer of oRecord to its files, closes
+   them and frees oRecord. Returns 1 if successful and 0 if not. */
+int Record_close(Record_T oRecord);
+
+/* Stores in *psIndex the index entry of the record of *psGame that is
+   ulLength bytes long and starts at ulOffset of its archive. */
+void Record_makeIndex(const struct Record_Game *psGame,
+                      unsigned long ulOffset, size_t ulLength,
+                      struct Record_Index *psIndex);
+
+/* Writes the initial state of oBoard to psFile as the tracking text
+   does. */
+void Record_printStart(Board_T oBoard, FILE *psFile);
+
+/* Writes the move to row and column, with the column letter column,
+   that is move number count, to psFile as the tracking text does. */
+void Record_printMove(Board_T oBoard, int row, char column, int count,
+                      FILE *psFile);
+
+/* Writes the header of the state after a move to psFile as the
+   tracking text does, and lets the next player move on oBoard, which
+   writes the board itself if it is tracking. Returns what Board_draw
+   returns. */
+int Record_printDraw(Board_T oBoard, FILE *psFile);
+
+/* Writes the tracking text of the game *psGame to psFile, exactly as
+   the referee writes it with tracking on, and closes psFile. Returns
+   1 if successful and 0 if the moves of *psGame are not a game. */
+int Record_printText(const struct Record_Game *psGame, FILE *psFile);
+
+#endif
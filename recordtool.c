@@ -0,0 +1,174 @@
+/*--------------------------------------------------------------------*/
+/* recordtool.c                                                       */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for fdopen and fileno */
+#include <sys/stat.h>
+#include "board.h"
+#include "archive.h"
+
+/*--------------------------------------------------------------------*/
+/* Writes the tracking text of *psGame to stdout. Returns 1 if
+   successful and 0 if the record is not a game. */
+
+static int printGame(const struct Record_Game *psGame) {
+
+   FILE *psCopy;
+   int iFd;
+
+   /* Record_printText closes the file it writes to, so give it a
+      stream of its own on a copy of stdout. */
+   fflush(stdout);
+   iFd = dup(fileno(stdout));
+   if (iFd == -1) return 0;
+   psCopy = fdopen(iFd, "w");
+   if (psCopy == NULL) {
+      close(iFd);
+      return 0;
+   }
+   return Record_printText(psGame, psCopy);
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the tracking text of game number lGame of oArchive, counting
+   from 0, to stdout. pcFile is the name of the archive. Returns 1 if
+   successful and 0 if not. */
+
+static int showGame(Archive_T oArchive, long lGame, const char *pcFile) {
+
+   struct Record_Game sGame;
+
+   if (Archive_getGame(oArchive, lGame, &sGame) == 0) {
+      fprintf(stderr, "%s: game %ld is damaged\n", pcFile, lGame + 1);
+      return 0;
+   }
+   if (printGame(&sGame) == 0) {
+      fprintf(stderr, "%s: game %ld is not a game of othello\n",
+              pcFile, lGame + 1);
+      return 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes one line about each game of oArchive that pcName played, or
+   about each game if pcName is NULL, to stdout: its number, counting
+   from 1, the players, how it ended and the score. pcFile is the name
+   of the archive. Returns 1 if successful and 0 if not. */
+
+static int listGames(Archive_T oArchive, const char *pcName,
+                     const char *pcFile) {
+
+   static const char *apcEnds[] = {"", " (crashed)", " (timed out)",
+                                   " (bad move)"};
+   struct Record_Game sGame;
+   long lGame;
+
+   lGame = 0;
+   for (;;) {
+      if (pcName != NULL)
+         lGame = Archive_findPlayer(oArchive, pcName, lGame);
+      if (lGame == -1 || lGame >= Archive_getCount(oArchive)) break;
+      if (Archive_getGame(oArchive, lGame, &sGame) == 0) {
+         fprintf(stderr, "%s: game %ld is damaged\n", pcFile,
+                 lGame + 1);
+         return 0;
+      }
+      printf("%ld: %s vs %s: %d%s\n", lGame + 1, sGame.acPlayer1,
+             sGame.acPlayer2, sGame.iScore, apcEnds[sGame.iEnd]);
+      lGame++;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Reads the archive of game records named on the command line:
+
+      recordtool archive [game]      the tracking text of all games,
+                                     or of game number game
+      recordtool -list archive       one line per game
+      recordtool -player name archive
+                                     one line per game of player name
+      recordtool -index archive      writes the index anew, of the
+                                     records before the first that
+                                     cannot be read
+
+   The tracking text is exactly what the referee writes with
+   -tracking, and games are numbered from 1. argc is the command line
+   argument count and argv the arguments. Returns 0 if successful and
+   EXIT_FAILURE if not. */
+
+int main(int argc, char *argv[]) {
+
+   Archive_T oArchive;
+   const char *pcFile, *pcName;
+   struct stat sStat;
+   unsigned long ulEnd;
+   long lGame, lWanted, lCount;
+   int iList, iOk;
+
+   iList = 0;
+   pcName = NULL;
+   if (argc == 3 && strcmp(argv[1], "-index") == 0) {
+      lCount = Archive_reindex(argv[2], &ulEnd);
+      if (lCount == -1) {
+         fprintf(stderr, "%s: cannot index %s\n", argv[0], argv[2]);
+         return EXIT_FAILURE;
+      }
+      printf("%ld games\n", lCount);
+
+      /* Leave it to the user to truncate the archive, as what follows
+         may be worth saving. */
+      if (stat(argv[2], &sStat) == 0
+          && ulEnd < (unsigned long)sStat.st_size)
+         printf("%s cannot be read after byte %lu of %lu\n", argv[2],
+                ulEnd, (unsigned long)sStat.st_size);
+      return 0;
+   }
+   if (argc == 3 && strcmp(argv[1], "-list") == 0) {
+      iList = 1;
+      pcFile = argv[2];
+   }
+   else if (argc == 4 && strcmp(argv[1], "-player") == 0) {
+      iList = 1;
+      pcName = argv[2];
+      pcFile = argv[3];
+   }
+   else if ((argc == 2 || argc == 3) && argv[1][0] != '-')
+      pcFile = argv[1];
+   else {
+      fprintf(stderr, "Usage: %s [-list | -player name | -index] "
+              "archive [game]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   oArchive = Archive_open(pcFile);
+   if (oArchive == NULL) {
+      fprintf(stderr, "%s: cannot open %s or its index\n", argv[0],
+              pcFile);
+      return EXIT_FAILURE;
+   }
+
+   iOk = 1;
+   if (iList == 1)
+      iOk = listGames(oArchive, pcName, pcFile);
+   else if (argc == 3) {
+      lWanted = atol(argv[2]);
+      if (lWanted < 1 || lWanted > Archive_getCount(oArchive)) {
+         fprintf(stderr, "%s: there is no game %s\n", pcFile, argv[2]);
+         iOk = 0;
+      }
+      else
+         iOk = showGame(oArchive, lWanted - 1, pcFile);
+   }
+   else
+      for (lGame = 0; iOk == 1 && lGame < Archive_getCount(oArchive);
+           lGame++)
+         iOk = showGame(oArchive, lGame, pcFile);
+
+   Archive_close(oArchive);
+   if (iOk == 0) return EXIT_FAILURE;
+   return 0;
+}
+/*--------------------------------------------------------------------*/
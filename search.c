@@ -0,0 +1,382 @@
+/*--------------------------------------------------------------------*/
+/* search.c                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for sysconf */
+#include <pthread.h>
+#include "search.h"
+#include "bitboard.h"
+#include "eval.h"
+#include "tt.h"
+#include "metrics.h"
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Number of tiles on the board. */
+enum {TILES = 64};
+
+/* Score of every tile of difference at the end of the game. Large
+   enough that a finished game outweighs any evaluation. */
+enum {DISC_SCORE = 10000};
+
+/* Larger than any score. */
+enum {INFINITE_SCORE = TILES * DISC_SCORE + 1};
+
+/* Number of nodes searched between checks of the clock and of the
+   stop flag. */
+enum {CLOCK_CHECK = 1024};
+
+/* Most threads of a parallel search. */
+enum {MAX_THREADS = 256};
+
+/* The stop flag of a parallel search is written by one thread while
+   the others read it, so it is loaded and stored atomically (see
+   tt.c). */
+#ifdef __GNUC__
+#define SEARCH_LOAD(pi) __atomic_load_n((pi), __ATOMIC_RELAXED)
+#define SEARCH_STORE(pi, i) __atomic_store_n((pi), (i), __ATOMIC_RELAXED)
+#else
+#define SEARCH_LOAD(pi) (*(volatile int *)(pi))
+#define SEARCH_STORE(pi, i) ((void)(*(volatile int *)(pi) = (i)))
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* The tiles in the order their moves are tried, best weight first. */
+static const int aiOrder[TILES] = {
+   0, 7, 56, 63, 2, 5, 16, 23, 40, 47, 58, 61, 3, 4, 24, 31,
+   32, 39, 59, 60, 18, 19, 20, 21, 26, 27, 28, 29, 34, 35, 36, 37,
+   42, 43, 44, 45, 10, 11, 12, 13, 17, 22, 25, 30, 33, 38, 41, 46,
+   50, 51, 52, 53, 1, 6, 8, 15, 48, 55, 57, 62, 9, 14, 49, 54
+};
+
+/* The state of one search. */
+struct Search {
+   /* The time at which the search has to stop, in milliseconds of the
+      monotonic clock, or 0 if it has no time limit. */
+   long lDeadline;
+
+   /* The number of nodes searched so far. */
+   long lNodes;
+
+   /* The transposition table, or NULL if there is none. */
+   TT_T oTT;
+
+   /* Whether the search ran out of time or was stopped. */
+   int iAborted;
+
+   /* The flag that another thread sets to stop the search, or NULL if
+      nothing stops it but the clock. */
+   int *piStop;
+};
+
+/* One thread of a search and what it found. */
+struct Thread {
+   struct Search sSearch;
+
+   /* The board the thread searches, and the storage of its copy of
+      the board if it is a helper. */
+   Board_T oBoard;
+   struct Board_Storage sBoard;
+
+   /* The first and the last depth of its iterations. */
+   int iFirstDepth;
+   int iMaxDepth;
+
+   /* When the search started and how long it may take, in
+      milliseconds. Only the calling thread looks at them. */
+   long lStart;
+   long lMillis;
+
+   /* The deepest iteration it finished (0 for none), and the best move
+      and score that iteration found. */
+   int iDepth;
+   int iBest;
+   int iScore;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns the final score of oBoard for player, i.e. the difference
+   between the player's tiles and the other player's. */
+
+static int Search_finalScore(Board_T oBoard, int player) {
+   return DISC_SCORE * (Board_getCount(oBoard, player)
+                        - Board_getCount(oBoard, 3 - player));
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the static evaluation of oBoard for the current player (see
+   eval.h). */
+
+static int Search_evaluate(Board_T oBoard) {
+
+   int player;
+
+   player = Board_getPlayer(oBoard);
+   return Eval_evaluateMoves(Board_getTiles(oBoard, player),
+                             Board_getTiles(oBoard, 3 - player),
+                             Board_getMoves(oBoard, player),
+                             Board_getMoves(oBoard, 3 - player));
+}
+
+/*--------------------------------------------------------------------*/
+/* Searches oBoard iDepth moves deep with the window iAlpha, iBeta for
+   the search psSearch. Returns the score of oBoard for the current
+   player, or 0 if the search ran out of time. */
+
+static int Search_negamax(struct Search *psSearch, Board_T oBoard,
+                          int iDepth, int iAlpha, int iBeta) {
+
+   struct TT_Entry sEntry;
+   uint64_t uMoves;
+   int player, i, iSquare, iScore, iBest, iBestMove, iFirst, iAlpha0;
+
+   psSearch->lNodes++;
+   if (psSearch->lNodes % CLOCK_CHECK == 0
+       && ((psSearch->lDeadline != 0
+            && Metrics_millis() >= psSearch->lDeadline)
+           || (psSearch->piStop != NULL
+               && SEARCH_LOAD(psSearch->piStop) != 0)))
+      psSearch->iAborted = 1;
+   if (psSearch->iAborted == 1) return 0;
+
+   if (iDepth == 0) return Search_evaluate(oBoard);
+
+   /* Use what an earlier search found out about the board: its score
+      if it looked far enough ahead, and its best move if not. */
+   iFirst = TT_NO_MOVE;
+   if (psSearch->oTT != NULL
+       && TT_probe(psSearch->oTT, Board_getHash(oBoard), &sEntry) == 1) {
+      if (sEntry.depth >= iDepth) {
+         if (sEntry.bound == TT_EXACT) return sEntry.score;
+         if (sEntry.bound == TT_LOWER && sEntry.score >= iBeta)
+            return sEntry.score;
+         if (sEntry.bound == TT_UPPER && sEntry.score <= iAlpha)
+            return sEntry.score;
+      }
+      iFirst = sEntry.move;
+   }
+
+   player = Board_getPlayer(oBoard);
+   uMoves = Board_legalMoves(oBoard);
+   iAlpha0 = iAlpha;
+   iBest = -INFINITE_SCORE;
+   iBestMove = TT_NO_MOVE;
+   for (i = -1; i < TILES; i++) {
+      /* Try the move from the transposition table first. */
+      iSquare = (i == -1) ? iFirst : aiOrder[i];
+      if (iSquare == TT_NO_MOVE || (i >= 0 && iSquare == iFirst))
+         continue;
+      if ((uMoves & ((uint64_t)1 << iSquare)) == 0) continue;
+
+      /* Make the move, then score the position after it. The same
+         player moves again if the other player has to pass. */
+      Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+      if (Board_draw(oBoard) == 0)
+         iScore = Search_finalScore(oBoard, player);
+      else if (Board_getPlayer(oBoard) == player)
+         iScore = Search_negamax(psSearch, oBoard, iDepth - 1, iAlpha,
+                                 iBeta);
+      else
+         iScore = -Search_negamax(psSearch, oBoard, iDepth - 1, -iBeta,
+                                  -iAlpha);
+      Board_unmakeMove(oBoard);
+      if (psSearch->iAborted == 1) return 0;
+
+      if (iScore > iBest) {
+         iBest = iScore;
+         iBestMove = iSquare;
+      }
+      if (iScore > iAlpha) iAlpha = iScore;
+      if (iAlpha >= iBeta) break;
+   }
+
+   if (psSearch->oTT != NULL) {
+      sEntry.score = iBest;
+      sEntry.move = (uint8_t)iBestMove;
+      sEntry.depth = (uint8_t)iDepth;
+      if (iBest <= iAlpha0) sEntry.bound = TT_UPPER;
+      else if (iBest >= iBeta) sEntry.bound = TT_LOWER;
+      else sEntry.bound = TT_EXACT;
+      TT_store(psSearch->oTT, Board_getHash(oBoard), &sEntry);
+   }
+   return iBest;
+}
+
+/*--------------------------------------------------------------------*/
+/* Searches every move of the current player on oBoard iDepth moves
+   deep for psSearch, starting with iFirst. Stores the best move in
+   *piBest. Returns its score, or 0 if the search ran out of time. */
+
+static int Search_root(struct Search *psSearch, Board_T oBoard,
+                       int iDepth, int iFirst, int *piBest) {
+
+   uint64_t uMoves;
+   int player, i, iSquare, iScore, iAlpha;
+
+   player = Board_getPlayer(oBoard);
+   uMoves = Board_legalMoves(oBoard);
+   iAlpha = -INFINITE_SCORE;
+   for (i = -1; i < TILES; i++) {
+      /* Try the best move of the last iteration first. */
+      iSquare = (i == -1) ? iFirst : aiOrder[i];
+      if (i >= 0 && iSquare == iFirst) continue;
+      if ((uMoves & ((uint64_t)1 << iSquare)) == 0) continue;
+
+      Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+      if (Board_draw(oBoard) == 0)
+         iScore = Search_finalScore(oBoard, player);
+      else if (Board_getPlayer(oBoard) == player)
+         iScore = Search_negamax(psSearch, oBoard, iDepth - 1, iAlpha,
+                                 INFINITE_SCORE);
+      else
+         iScore = -Search_negamax(psSearch, oBoard, iDepth - 1,
+                                  -INFINITE_SCORE, -iAlpha);
+      Board_unmakeMove(oBoard);
+      if (psSearch->iAborted == 1) return 0;
+
+      if (iScore > iAlpha) {
+         iAlpha = iScore;
+         *piBest = iSquare;
+      }
+   }
+   return iAlpha;
+}
+
+/*--------------------------------------------------------------------*/
+/* Searches the board of psThread one move deeper each iteration, from
+   its first depth to its last, until its search runs out of time or is
+   stopped. Stops early, if the search has a time limit, once an
+   iteration ends after half of the time has passed: each one takes
+   several times as long as the one before. */
+
+static void Search_deepen(struct Thread *psThread) {
+
+   int iDepth, iMove, iScore;
+
+   for (iDepth = psThread->iFirstDepth; iDepth <= psThread->iMaxDepth;
+        iDepth++) {
+      iMove = psThread->iBest;
+      iScore = Search_root(&psThread->sSearch, psThread->oBoard, iDepth,
+                           psThread->iBest, &iMove);
+      if (psThread->sSearch.iAborted == 1) break;
+      psThread->iDepth = iDepth;
+      psThread->iBest = iMove;
+      psThread->iScore = iScore;
+      if (psThread->sSearch.lDeadline != 0
+          && Metrics_millis() - psThread->lStart
+             > psThread->lMillis / 2)
+         break;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Runs Search_deepen() for the helper thread pvThread, a struct
+   Thread, until the calling thread stops it. Returns NULL. */
+
+static void *Search_help(void *pvThread) {
+   Search_deepen((struct Thread *)pvThread);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+int Search_bestMove(Board_T oBoard, TT_T oTT, int iMaxDepth,
+                    long lMillis, int *piRow, int *piColumn) {
+   return Search_bestMoveParallel(oBoard, oTT, iMaxDepth, lMillis, 1,
+                                  piRow, piColumn, NULL);
+}
+
+/*--------------------------------------------------------------------*/
+int Search_bestMoveParallel(Board_T oBoard, TT_T oTT, int iMaxDepth,
+                            long lMillis, int iThreads, int *piRow,
+                            int *piColumn, struct Search_Stats *psStats) {
+
+   struct Thread *psThreads, *psThread;
+   pthread_t aiThreads[MAX_THREADS];
+   uint64_t uMoves;
+   int i, iEmpty, iFirst, iStarted, iStop, iChosen;
+   long lStart;
+
+   assert(oBoard != NULL);
+   assert(iThreads >= 0);
+   assert(piRow != NULL);
+   assert(piColumn != NULL);
+
+   uMoves = Board_legalMoves(oBoard);
+   assert(uMoves != 0);
+
+   if (iThreads == 0) iThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   if (iThreads < 1 || oTT == NULL) iThreads = 1;
+   if (iThreads > MAX_THREADS) iThreads = MAX_THREADS;
+   psThreads = (struct Thread *)calloc((size_t)iThreads,
+                                       sizeof(struct Thread));
+   assert(psThreads != NULL);
+
+   lStart = Metrics_millis();
+   if (oTT != NULL) TT_newSearch(oTT);
+
+   /* Start from the first move in order in case not even the first
+      iteration finishes. */
+   for (iFirst = 0; (uMoves & ((uint64_t)1 << aiOrder[iFirst])) == 0;
+        iFirst++);
+   iFirst = aiOrder[iFirst];
+
+   /* Search no deeper than the end of the game. */
+   iEmpty = Bitboard_count(Board_getEmpty(oBoard));
+   if (iMaxDepth > iEmpty) iMaxDepth = iEmpty;
+
+   /* Every other helper starts one move deeper, so that the threads
+      are not all busy with the same iteration and the deeper ones
+      leave results in the table for the others to pick up. */
+   iStop = 0;
+   for (i = 0; i < iThreads; i++) {
+      psThread = &psThreads[i];
+      psThread->sSearch.lDeadline = 0;
+      if (lMillis > 0) psThread->sSearch.lDeadline = lStart + lMillis;
+      psThread->sSearch.lNodes = 0;
+      psThread->sSearch.oTT = oTT;
+      psThread->sSearch.iAborted = 0;
+      psThread->sSearch.piStop = (i == 0) ? NULL : &iStop;
+      psThread->oBoard = (i == 0) ? oBoard
+         : Board_copyIn(&psThread->sBoard, oBoard);
+      psThread->iFirstDepth = 1 + i % 2;
+      psThread->iMaxDepth = iMaxDepth;
+      psThread->lStart = lStart;
+      psThread->lMillis = lMillis;
+      psThread->iDepth = 0;
+      psThread->iBest = iFirst;
+      psThread->iScore = 0;
+   }
+
+   /* A helper that cannot be started is left out. */
+   for (iStarted = 1; iStarted < iThreads; iStarted++)
+      if (pthread_create(&aiThreads[iStarted], NULL, Search_help,
+                         &psThreads[iStarted]) != 0)
+         break;
+   Search_deepen(&psThreads[0]);
+   SEARCH_STORE(&iStop, 1);
+   for (i = 1; i < iStarted; i++) pthread_join(aiThreads[i], NULL);
+
+   /* Play the move of the deepest finished iteration. */
+   iChosen = 0;
+   for (i = 1; i < iStarted; i++)
+      if (psThreads[i].iDepth > psThreads[iChosen].iDepth) iChosen = i;
+   psThread = &psThreads[iChosen];
+   *piRow = psThread->iBest / SIZE;
+   *piColumn = psThread->iBest % SIZE;
+
+   if (psStats != NULL) {
+      psStats->lNodes = 0;
+      for (i = 0; i < iStarted; i++)
+         psStats->lNodes += psThreads[i].sSearch.lNodes;
+      psStats->lMillis = Metrics_millis() - lStart;
+      psStats->iDepth = psThread->iDepth;
+      psStats->iThreads = iStarted;
+   }
+   i = psThread->iScore;
+   free(psThreads);
+   return i;
+}
+/*--------------------------------------------------------------------*/
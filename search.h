@@ -0,0 +1,51 @@
+/*--------------------------------------------------------------------*/
+/* search.h                                                           */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef SEARCH_INCLUDED
+#define SEARCH_INCLUDED
+
+#include "board.h"
+#include "tt.h"
+
+/* Finds the best move for the current player on oBoard with an
+   iterative deepening negamax search with alpha-beta pruning. Each
+   iteration searches one move deeper, up to iMaxDepth moves, until
+   lMillis milliseconds of wall clock time have passed (0 for no
+   limit). Results are shared through the transposition table oTT
+   unless it is NULL. Stores the row and column of the move in *piRow
+   and *piColumn. Returns the score of the move for the current player.
+   oBoard is left as it was. The current player must have a valid
+   move. */
+int Search_bestMove(Board_T oBoard, TT_T oTT, int iMaxDepth,
+                    long lMillis, int *piRow, int *piColumn);
+
+/* What a search did, for Search_bestMoveParallel. */
+struct Search_Stats {
+   /* The number of nodes searched by all the threads together. */
+   long lNodes;
+
+   /* The milliseconds of wall clock time the search took. */
+   long lMillis;
+
+   /* The deepest iteration that a thread finished. */
+   int iDepth;
+
+   /* The number of threads that searched. */
+   int iThreads;
+};
+
+/* Does what Search_bestMove does with iThreads threads (0 for one per
+   processor): the calling thread searches as Search_bestMove does,
+   while helper threads search copies of oBoard, some of them one move
+   deeper, and store what they find in oTT for every thread to use
+   (lazy SMP). The move of the deepest iteration that any thread
+   finished is played, that of the calling thread if there are several.
+   The helpers only help through oTT, so without one the calling
+   thread searches alone. Stores what the search did in *psStats
+   unless psStats is NULL. */
+int Search_bestMoveParallel(Board_T oBoard, TT_T oTT, int iMaxDepth,
+                            long lMillis, int iThreads, int *piRow,
+                            int *piColumn, struct Search_Stats *psStats);
+
+#endif
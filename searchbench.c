@@ -0,0 +1,158 @@
+/*--------------------------------------------------------------------*/
+/* searchbench.c                                                      */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for sysconf */
+#include "board.h"
+#include "bitboard.h"
+#include "random.h"
+#include "search.h"
+#include "eval.h"
+#include "tt.h"
+
+/* Times the parallel search of search.c on the same positions with
+   1, 2, 4, ... threads, up to the most given, and prints the nodes
+   per second of each and its scaling efficiency: how much sooner it
+   finished the same depths than one thread did, divided by the number
+   of threads. Every search starts from an empty transposition table,
+   so that the threads only share what they find themselves. */
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Most threads. */
+enum {MAX_THREADS = 256};
+
+/* The options that are not given: positions, random moves that lead
+   to each position and depth of the searches. */
+enum {POSITIONS = 16, PLIES = 20, DEPTH = 9};
+
+/* Bytes of memory for the transposition table, as the engine has. */
+enum {TT_BYTES = 64 * 1024 * 1024};
+
+/*--------------------------------------------------------------------*/
+/* Plays iPlies random moves from the initial position on oBoard,
+   seeded with lPosition, so that the same position is reached every
+   time. Returns 1, or 0 if the game ends first. */
+
+static int playRandom(Board_T oBoard, long lPosition, int iPlies) {
+
+   uint64_t uState;
+   int iSquare, i;
+
+   uState = Random_seed((uint64_t)lPosition);
+   for (i = 0; i < iPlies; i++) {
+      iSquare = Random_pick(Board_legalMoves(oBoard), &uState);
+      Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+      if (Board_draw(oBoard) == 0) return 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Searches each of the lPositions positions iDepth moves deep with
+   iThreads threads and oTT, emptied first. Stores the total of what
+   the searches did in *psTotal. */
+
+static void searchAll(TT_T oTT, long lPositions, int iPlies, int iDepth,
+                      int iThreads, struct Search_Stats *psTotal) {
+
+   struct Board_Storage sBoard;
+   struct Search_Stats sStats;
+   Board_T oBoard;
+   long lPosition;
+   int row, column;
+
+   psTotal->lNodes = 0;
+   psTotal->lMillis = 0;
+   psTotal->iDepth = iDepth;
+   psTotal->iThreads = iThreads;
+   for (lPosition = 0; lPosition < lPositions; lPosition++) {
+      oBoard = Board_initIn(&sBoard, 0, NULL);
+      if (playRandom(oBoard, lPosition, iPlies) == 0) continue;
+      TT_clear(oTT);
+      (void)Search_bestMoveParallel(oBoard, oTT, iDepth, 0, iThreads,
+                                    &row, &column, &sStats);
+      psTotal->lNodes += sStats.lNodes;
+      psTotal->lMillis += sStats.lMillis;
+      if (sStats.iDepth < psTotal->iDepth)
+         psTotal->iDepth = sStats.iDepth;
+      if (sStats.iThreads < psTotal->iThreads)
+         psTotal->iThreads = sStats.iThreads;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Searches positions reached by random moves with more and more
+   threads and prints how fast each number of threads was:
+
+      searchbench [-threads n] [-positions n] [-plies n] [-depth n]
+
+   where -threads is the most threads (one per processor if not
+   given), -positions the number of positions, -plies the random moves
+   that lead to each and -depth how deep each is searched. argc is the
+   command line argument count and argv the arguments. Returns 0, or
+   EXIT_FAILURE if the arguments are not valid. */
+
+int main(int argc, char *argv[]) {
+
+   struct Search_Stats sStats;
+   TT_T oTT;
+   long lPositions, lSingle;
+   int iMaxThreads, iThreads, iPlies, iDepth, i;
+   double dSpeedup;
+
+   iMaxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   lPositions = POSITIONS;
+   iPlies = PLIES;
+   iDepth = DEPTH;
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+         iMaxThreads = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-positions") == 0 && i + 1 < argc)
+         lPositions = atol(argv[++i]);
+      else if (strcmp(argv[i], "-plies") == 0 && i + 1 < argc)
+         iPlies = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-depth") == 0 && i + 1 < argc)
+         iDepth = atoi(argv[++i]);
+      else iMaxThreads = 0;
+   }
+   if (iMaxThreads < 1 || iMaxThreads > MAX_THREADS || lPositions < 1
+       || iPlies < 0 || iDepth < 1) {
+      fprintf(stderr, "Usage: %s [-threads n] [-positions n] "
+              "[-plies n] [-depth n]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   Eval_init();
+   oTT = TT_new(TT_BYTES);
+   if (oTT == NULL) {
+      fprintf(stderr, "%s: out of memory\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   printf("%ld positions after %d random moves, depth %d, %s flips\n",
+          lPositions, iPlies, iDepth, Bitboard_getFlipKernel());
+   lSingle = 0;
+   for (iThreads = 1; ; iThreads *= 2) {
+      if (iThreads > iMaxThreads) iThreads = iMaxThreads;
+      searchAll(oTT, lPositions, iPlies, iDepth, iThreads, &sStats);
+      if (iThreads == 1) lSingle = sStats.lMillis;
+
+      /* Time to the same depth is what counts: the helpers search
+         nodes that the main thread would not. */
+      dSpeedup = (sStats.lMillis == 0) ? 0.0
+         : (double)lSingle / sStats.lMillis;
+      printf("%3d threads: %8.3f s %12ld nodes %12.0f nodes/s "
+             "speedup %5.2f efficiency %5.1f%%\n", sStats.iThreads,
+             sStats.lMillis / 1000.0, sStats.lNodes,
+             sStats.lMillis == 0 ? 0.0
+             : sStats.lNodes * 1000.0 / sStats.lMillis,
+             dSpeedup, 100.0 * dSpeedup / sStats.iThreads);
+      if (iThreads == iMaxThreads) break;
+   }
+   TT_free(oTT);
+   return 0;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,352 @@
+/*--------------------------------------------------------------------*/
+/* selfplay.c                                                         */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for sysconf */
+#include <pthread.h>
+#include "board.h"
+#include "bitboard.h"
+#include "random.h"
+#include "search.h"
+#include "eval.h"
+#include "metrics.h"
+
+/* Plays games between built-in policies inside the process, on every
+   core, and writes every position of them with the final score of
+   its game to shard files, for tuning evaluation functions. Each
+   thread writes its own shards, named like the prefix followed by
+   ".thread.shard", and starts a new one after a set number of
+   positions. A shard is a run of POSITION_BYTES byte records:
+
+      0  the tiles of FIRST, a bitboard (see bitboard.h)
+      8  the tiles of SECOND
+     16  the player to move, 1 or 2
+     17  the final score of the game, FIRST's tiles less SECOND's, as
+         a signed byte
+
+   with the bitboards stored least significant byte first. Each game
+   is seeded with its number, so the same options always give the
+   same games, however many threads play them. */
+
+/* Size of the board is 8 by 8. */
+enum {SIZE = 8};
+
+/* Bytes of a position in a shard. */
+enum {POSITION_BYTES = 18};
+
+/* Bytes of the buffer of a shard. */
+enum {BUFFER_SIZE = 1 << 20};
+
+/* Most moves of a game. */
+enum {MAX_MOVES = 60};
+
+/* Most threads. */
+enum {MAX_THREADS = 256};
+
+/* The options that are not given: games, random moves that open each
+   game, depth of the search policy and positions per shard. */
+enum {GAMES = 10000, OPENING = 8, DEPTH = 4, SHARD_POSITIONS = 1 << 22};
+
+/* The policies that choose moves. */
+enum Policy {POLICY_RANDOM, POLICY_GREEDY, POLICY_SEARCH};
+
+/*--------------------------------------------------------------------*/
+
+/* The names of the policies, by enum Policy. */
+static const char *apcPolicies[] = {"random", "greedy", "search"};
+
+/* What all the threads play. */
+struct Selfplay {
+   /* The policies of the two sides. Side 0 plays FIRST in even
+      games and SECOND in odd ones. */
+   int aiPolicy[2];
+
+   /* The number of games, of random moves that open each game, the
+      depth of the search policy and positions per shard. */
+   long lGames;
+   int iOpening;
+   int iDepth;
+   long lShardPositions;
+
+   /* The prefix of the names of the shards, and how many threads
+      there are. */
+   const char *pcPrefix;
+   int iThreads;
+};
+
+/* One thread of the self-play. */
+struct Worker {
+   const struct Selfplay *psSelfplay;
+   int iIndex;
+
+   /* The shard being written, its number and its positions so far. */
+   FILE *psShard;
+   int iShard;
+   long lPositions;
+
+   /* The games and positions it played, and whether writing failed. */
+   long lGames;
+   long lTotal;
+   int iFailed;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns the move that the policy iPolicy of psSelfplay makes on
+   oBoard, as a tile, with the random state *puState. */
+
+static int chooseMove(const struct Selfplay *psSelfplay, int iPolicy,
+                      Board_T oBoard, uint64_t *puState) {
+
+   uint64_t uMoves, uOwn, uOpp, uBest;
+   int iSquare, iFlips, iMost, row, column;
+
+   uMoves = Board_legalMoves(oBoard);
+   if (iPolicy == POLICY_SEARCH) {
+      (void)Search_bestMove(oBoard, NULL, psSelfplay->iDepth, 0, &row,
+                            &column);
+      return row * SIZE + column;
+   }
+   if (iPolicy == POLICY_GREEDY) {
+      /* The moves that flip the most tiles, one picked at random. */
+      uOwn = Board_getTiles(oBoard, Board_getPlayer(oBoard));
+      uOpp = Board_getTiles(oBoard, 3 - Board_getPlayer(oBoard));
+      uBest = 0;
+      iMost = 0;
+      for (; uMoves != 0; uMoves &= uMoves - 1) {
+         iSquare = Bitboard_first(uMoves);
+         iFlips = Bitboard_count(Bitboard_flips(uOwn, uOpp, iSquare));
+         if (iFlips > iMost) {
+            iMost = iFlips;
+            uBest = 0;
+         }
+         if (iFlips == iMost) uBest |= (uint64_t)1 << iSquare;
+      }
+      uMoves = uBest;
+   }
+   return Random_pick(uMoves, puState);
+}
+
+/*--------------------------------------------------------------------*/
+/* Stores the bitboard u in pucBytes, least significant byte first. */
+
+static void putBitboard(unsigned char *pucBytes, uint64_t u) {
+
+   int i;
+
+   for (i = 0; i < 8; i++) {
+      pucBytes[i] = (unsigned char)(u & 0xFF);
+      u >>= 8;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the iCount positions of a game in pucGame, each missing its
+   final score, to the shard of psWorker with the final score iScore,
+   starting a new shard if the one being written is full. Returns 1 if
+   successful and 0 if not. */
+
+static int writeGame(struct Worker *psWorker, unsigned char *pucGame,
+                     int iCount, int iScore) {
+
+   const struct Selfplay *psSelfplay;
+   char acName[FILENAME_MAX];
+   int i;
+
+   psSelfplay = psWorker->psSelfplay;
+   if (psWorker->psShard != NULL
+       && psWorker->lPositions >= psSelfplay->lShardPositions) {
+      if (fclose(psWorker->psShard) != 0) return 0;
+      psWorker->psShard = NULL;
+      psWorker->iShard++;
+   }
+   if (psWorker->psShard == NULL) {
+      snprintf(acName, sizeof(acName), "%s.%d.%d", psSelfplay->pcPrefix,
+               psWorker->iIndex, psWorker->iShard);
+      psWorker->psShard = fopen(acName, "wb");
+      if (psWorker->psShard == NULL) {
+         perror(acName);
+         return 0;
+      }
+      setvbuf(psWorker->psShard, NULL, _IOFBF, BUFFER_SIZE);
+      psWorker->lPositions = 0;
+   }
+
+   for (i = 0; i < iCount; i++)
+      pucGame[i * POSITION_BYTES + 17] = (unsigned char)(signed char)iScore;
+   if (fwrite(pucGame, POSITION_BYTES, (size_t)iCount, psWorker->psShard)
+       != (size_t)iCount)
+      return 0;
+   psWorker->lPositions += iCount;
+   psWorker->lTotal += iCount;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays the games of the struct Worker pvWorker, every iThreads-th
+   one starting from its own index, and writes their positions to its
+   shards. Returns NULL. */
+
+static void *playGames(void *pvWorker) {
+
+   struct Worker *psWorker;
+   const struct Selfplay *psSelfplay;
+   struct Board_Storage sBoard;
+   unsigned char aucGame[MAX_MOVES * POSITION_BYTES];
+   unsigned char *pucPosition;
+   Board_T oBoard;
+   uint64_t uState;
+   long lGame;
+   int iCount, iSide, iSquare, player;
+
+   psWorker = (struct Worker *)pvWorker;
+   psSelfplay = psWorker->psSelfplay;
+   for (lGame = psWorker->iIndex; lGame < psSelfplay->lGames;
+        lGame += psSelfplay->iThreads) {
+      uState = Random_seed((uint64_t)lGame);
+
+      oBoard = Board_initIn(&sBoard, 0, NULL);
+      iCount = 0;
+      do {
+         player = Board_getPlayer(oBoard);
+         pucPosition = &aucGame[iCount * POSITION_BYTES];
+         putBitboard(pucPosition, Board_getTiles(oBoard, 1));
+         putBitboard(pucPosition + 8, Board_getTiles(oBoard, 2));
+         pucPosition[16] = (unsigned char)player;
+
+         /* Side 0 is FIRST in even games. */
+         iSide = (int)((lGame + player - 1) % 2);
+         if (iCount < psSelfplay->iOpening)
+            iSquare = Random_pick(Board_legalMoves(oBoard), &uState);
+         else
+            iSquare = chooseMove(psSelfplay, psSelfplay->aiPolicy[iSide],
+                                 oBoard, &uState);
+         Board_makeMove(oBoard, iSquare / SIZE, iSquare % SIZE);
+         iCount++;
+      } while (Board_draw(oBoard) != 0);
+
+      if (writeGame(psWorker, aucGame, iCount, Board_getScore(oBoard))
+          == 0) {
+         psWorker->iFailed = 1;
+         break;
+      }
+      psWorker->lGames++;
+   }
+   if (psWorker->psShard != NULL && fclose(psWorker->psShard) != 0)
+      psWorker->iFailed = 1;
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the enum Policy named pcName, or -1 if there is none. */
+
+static int findPolicy(const char *pcName) {
+
+   int i;
+
+   for (i = 0; i < (int)(sizeof(apcPolicies) / sizeof(apcPolicies[0]));
+        i++)
+      if (strcmp(pcName, apcPolicies[i]) == 0) return i;
+   return -1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays games between the two policies named on the command line and
+   writes their positions to shards named after the prefix given:
+
+      selfplay [-threads n] [-games n] [-opening n] [-depth n]
+               [-shard n] [-weights file] policy1 policy2 prefix
+
+   where a policy is random, greedy (the move that flips the most
+   tiles) or search (the engine's search, -depth moves deep). -opening
+   is the number of random moves that open each game, and -shard the
+   most positions of a shard. -weights is the weight file the search
+   policy evaluates with (see eval.h). Prints how many games and
+   positions per second were played. argc is the command line argument
+   count and argv the arguments. Returns 0, or EXIT_FAILURE if the
+   arguments are not valid or a shard cannot be written. */
+
+int main(int argc, char *argv[]) {
+
+   struct Selfplay sSelfplay;
+   struct Worker asWorkers[MAX_THREADS];
+   pthread_t aiThreads[MAX_THREADS];
+   const char *apcArgs[3];
+   const char *pcWeights;
+   long lStart, lTime, lGames, lTotal;
+   int i, iArgs, iStarted, iRet;
+
+   sSelfplay.iThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   sSelfplay.lGames = GAMES;
+   sSelfplay.iOpening = OPENING;
+   sSelfplay.iDepth = DEPTH;
+   sSelfplay.lShardPositions = SHARD_POSITIONS;
+   pcWeights = NULL;
+   iArgs = 0;
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+         sSelfplay.iThreads = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-games") == 0 && i + 1 < argc)
+         sSelfplay.lGames = atol(argv[++i]);
+      else if (strcmp(argv[i], "-opening") == 0 && i + 1 < argc)
+         sSelfplay.iOpening = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-depth") == 0 && i + 1 < argc)
+         sSelfplay.iDepth = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-shard") == 0 && i + 1 < argc)
+         sSelfplay.lShardPositions = atol(argv[++i]);
+      else if (strcmp(argv[i], "-weights") == 0 && i + 1 < argc)
+         pcWeights = argv[++i];
+      else if (iArgs < 3) apcArgs[iArgs++] = argv[i];
+      else iArgs = 4;
+   }
+   if (iArgs == 3) {
+      sSelfplay.aiPolicy[0] = findPolicy(apcArgs[0]);
+      sSelfplay.aiPolicy[1] = findPolicy(apcArgs[1]);
+      sSelfplay.pcPrefix = apcArgs[2];
+   }
+   if (iArgs != 3 || sSelfplay.aiPolicy[0] == -1
+       || sSelfplay.aiPolicy[1] == -1 || sSelfplay.iThreads < 1
+       || sSelfplay.iThreads > MAX_THREADS || sSelfplay.lGames < 0
+       || sSelfplay.iDepth < 1 || sSelfplay.lShardPositions < 1) {
+      fprintf(stderr, "Usage: %s [-threads n] [-games n] [-opening n] "
+              "[-depth n] [-shard n] [-weights file] "
+              "random|greedy|search random|greedy|search prefix\n",
+              argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   Eval_init();
+   if (pcWeights != NULL && Eval_load(pcWeights) == 0) {
+      fprintf(stderr, "%s: cannot load weights from %s\n", argv[0],
+              pcWeights);
+      return EXIT_FAILURE;
+   }
+
+   lStart = Metrics_millis();
+   for (iStarted = 0; iStarted < sSelfplay.iThreads; iStarted++) {
+      memset(&asWorkers[iStarted], 0, sizeof(struct Worker));
+      asWorkers[iStarted].psSelfplay = &sSelfplay;
+      asWorkers[iStarted].iIndex = iStarted;
+      if (pthread_create(&aiThreads[iStarted], NULL, playGames,
+                         &asWorkers[iStarted]) != 0) {
+         perror("pthread_create");
+         break;
+      }
+   }
+   iRet = (iStarted == sSelfplay.iThreads) ? 0 : EXIT_FAILURE;
+   lGames = lTotal = 0;
+   for (i = 0; i < iStarted; i++) {
+      pthread_join(aiThreads[i], NULL);
+      lGames += asWorkers[i].lGames;
+      lTotal += asWorkers[i].lTotal;
+      if (asWorkers[i].iFailed == 1) iRet = EXIT_FAILURE;
+   }
+   lTime = Metrics_millis() - lStart;
+
+   printf("%ld games, %ld positions in %.3f s: %.0f games/s, "
+          "%.0f positions/s\n", lGames, lTotal, lTime / 1000.0,
+          lTime == 0 ? 0.0 : lGames * 1000.0 / lTime,
+          lTime == 0 ? 0.0 : lTotal * 1000.0 / lTime);
+   return iRet;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,194 @@
+/*--------------------------------------------------------------------*/
+/* spawnbench.c                                                       */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE 1 /* for pipe2 */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include "metrics.h"
+#include "player.h"
+
+/* Times how long it takes to start a player with Player_spawn, and
+   with fork and exec as the referee used to, and prints the latency
+   histograms of both (see Metrics_write): kind=launch is the time the
+   referee is busy starting the player, and kind=run the time until
+   the player has run and exited, which for a program that does
+   nothing is the whole cost of a process. The benchmark can hold
+   memory of its own first, as a referee that is running a tournament
+   does, since copying the page tables of a big process is what makes
+   fork slow. */
+
+/* The options that are not given: players started with each method,
+   megabytes held and the program started. */
+enum {COUNT = 500, MEGABYTES = 0};
+static const char acProgram[] = "/bin/true";
+
+/* The ways a player can be started. */
+enum {METHOD_SPAWN, METHOD_FORK, METHODS};
+
+/* The names of the methods, by the enum above. */
+static const char *apcMethods[METHODS] = {"spawn", "fork"};
+
+/*--------------------------------------------------------------------*/
+/* Starts pcPath with the arguments apcArgv as the referee used to:
+   with fork, dup2 of the pipes onto stdin and stdout in the child,
+   and execv. Stores what Player_spawn stores. Returns 1 if successful
+   and 0 if not. */
+
+static int forkPlayer(const char *pcPath, char *const apcArgv[],
+                      pid_t *piPid, int *piToChild, int *piFromChild) {
+
+   int aiToChild[2], aiFromChild[2];
+
+   if (pipe2(aiToChild, O_CLOEXEC) == -1) return 0;
+   if (pipe2(aiFromChild, O_CLOEXEC) == -1) {
+      close(aiToChild[0]);
+      close(aiToChild[1]);
+      return 0;
+   }
+   *piPid = fork();
+   if (*piPid == 0) {
+      if (dup2(aiToChild[0], 0) == -1) _exit(EXIT_FAILURE);
+      if (dup2(aiFromChild[1], 1) == -1) _exit(EXIT_FAILURE);
+      execv(pcPath, apcArgv);
+      _exit(EXIT_FAILURE);
+   }
+   close(aiToChild[0]);
+   close(aiFromChild[1]);
+   if (*piPid == -1) {
+      close(aiToChild[1]);
+      close(aiFromChild[0]);
+      return 0;
+   }
+   *piToChild = aiToChild[1];
+   *piFromChild = aiFromChild[0];
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Starts pcPath lCount times with the method iMethod, each time
+   waiting for it to exit, and adds the latencies to psLaunch and
+   psRun. Returns 1 if successful and 0 if a player cannot be
+   started. */
+
+static int timeMethod(int iMethod, const char *pcPath, long lCount,
+                      struct Metrics_Histogram *psLaunch,
+                      struct Metrics_Histogram *psRun) {
+
+   char *apcArgv[2];
+   char acBuffer[64];
+   uint64_t uStart, uLaunched;
+   ssize_t lRead;
+   pid_t iPid;
+   int iToChild, iFromChild, iOk;
+   long l;
+
+   apcArgv[0] = (char *)pcPath;
+   apcArgv[1] = NULL;
+   for (l = 0; l < lCount; l++) {
+      uStart = Metrics_now();
+      if (iMethod == METHOD_SPAWN)
+         iOk = Player_spawn(pcPath, apcArgv, &iPid, &iToChild,
+                            &iFromChild);
+      else
+         iOk = forkPlayer(pcPath, apcArgv, &iPid, &iToChild,
+                          &iFromChild);
+      if (iOk == 0) return 0;
+      uLaunched = Metrics_now();
+
+      /* The player has exited once its stdout is closed and it has
+         been waited for. */
+      close(iToChild);
+      for (;;) {
+         lRead = read(iFromChild, acBuffer, sizeof(acBuffer));
+         if (lRead == 0 || (lRead == -1 && errno != EINTR)) break;
+      }
+      close(iFromChild);
+      while (waitpid(iPid, NULL, 0) == -1 && errno == EINTR);
+      Metrics_add(psLaunch, uLaunched - uStart);
+      Metrics_add(psRun, Metrics_now() - uStart);
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Starts a program many times with each method and prints the
+   latencies:
+
+      spawnbench [-count n] [-mb n] [program]
+
+   where -count is how many times it is started with each method, -mb
+   the megabytes of memory held meanwhile and program the program
+   started, /bin/true if not given. argc is the command line argument
+   count and argv the arguments. Returns 0, or EXIT_FAILURE if the
+   arguments are not valid or the program cannot be started. */
+
+int main(int argc, char *argv[]) {
+
+   struct Metrics_Histogram *psLaunch, *psRun;
+   char acPrefix[64];
+   const char *pcProgram;
+   char *pcHeld;
+   long lCount, lMegabytes;
+   int i, iMethod;
+
+   lCount = COUNT;
+   lMegabytes = MEGABYTES;
+   pcProgram = acProgram;
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-count") == 0 && i + 1 < argc)
+         lCount = atol(argv[++i]);
+      else if (strcmp(argv[i], "-mb") == 0 && i + 1 < argc)
+         lMegabytes = atol(argv[++i]);
+      else pcProgram = argv[i];
+   }
+   if (lCount < 1 || lMegabytes < 0) {
+      fprintf(stderr, "Usage: %s [-count n] [-mb n] [program]\n",
+              argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   /* Touch every page, so that it has to be mapped in the child. */
+   pcHeld = NULL;
+   if (lMegabytes > 0) {
+      pcHeld = malloc((size_t)lMegabytes << 20);
+      if (pcHeld == NULL) {
+         fprintf(stderr, "%s: out of memory\n", argv[0]);
+         return EXIT_FAILURE;
+      }
+      memset(pcHeld, 1, (size_t)lMegabytes << 20);
+   }
+
+   psLaunch = calloc(1, sizeof(struct Metrics_Histogram));
+   psRun = calloc(1, sizeof(struct Metrics_Histogram));
+   if (psLaunch == NULL || psRun == NULL) {
+      fprintf(stderr, "%s: out of memory\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+   for (iMethod = 0; iMethod < METHODS; iMethod++) {
+      memset(psLaunch, 0, sizeof(struct Metrics_Histogram));
+      memset(psRun, 0, sizeof(struct Metrics_Histogram));
+      if (timeMethod(iMethod, pcProgram, lCount, psLaunch, psRun)
+          == 0) {
+         perror(pcProgram);
+         return EXIT_FAILURE;
+      }
+      sprintf(acPrefix, "method=%s mb=%ld kind=launch ",
+              apcMethods[iMethod], lMegabytes);
+      Metrics_write(stdout, acPrefix, psLaunch);
+      sprintf(acPrefix, "method=%s mb=%ld kind=run ",
+              apcMethods[iMethod], lMegabytes);
+      Metrics_write(stdout, acPrefix, psRun);
+   }
+   free(psLaunch);
+   free(psRun);
+   free(pcHeld);
+   return 0;
+}
+/*--------------------------------------------------------------------*/
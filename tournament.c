@@ -0,0 +1,548 @@
+/*--------------------------------------------------------------------*/
+/* tournament.c                                                       */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#define _GNU_SOURCE 1 /* for sysconf */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include "game.h"
+#include "match.h"
+#include "metrics.h"
+#include "mux.h"
+#include "pool.h"
+#include "tournament.h"
+
+/* Longest player name, including the null character. */
+enum {MAX_NAME = 256};
+
+/* Longest start of a line of metrics, including the null character. */
+enum {PREFIX_SIZE = 2 * MAX_NAME};
+
+/*--------------------------------------------------------------------*/
+
+/* A game of the schedule. */
+struct Pairing {
+   /* The index of the FIRST and the SECOND player. */
+   int iFirst;
+   int iSecond;
+
+   /* Whether the game was played, and its score if so. */
+   int iPlayed;
+   int iScore;
+};
+
+/* The standing of a player. */
+struct Standing {
+   /* The index of the player. */
+   int iPlayer;
+
+   /* The number of games played, won, drawn and lost. */
+   int iGames;
+   int iWins;
+   int iDraws;
+   int iLosses;
+
+   /* The number of tiles won minus the number of tiles lost, summed
+      over all games. */
+   int iDiscs;
+};
+
+/* The latencies of a player over all of its games. */
+struct Latency {
+   /* The number of games it played. */
+   int iGames;
+
+   /* How long it took for its moves, and the referee to check and
+      play them. */
+   struct Metrics_Histogram sThink;
+   struct Metrics_Histogram sReferee;
+};
+
+/* A tournament in progress, shared by the worker threads. */
+struct Tournament {
+   /* The names of the players, and whether each is offered the binary
+      protocol. */
+   char **ppcNames;
+   int *piBinary;
+   int iPlayers;
+
+   /* The games to play. */
+   struct Pairing *psPairings;
+   int iPairings;
+
+   /* The index of the next game to hand out. */
+   int iNext;
+
+   /* The number of games each worker thread plays at once. */
+   int iGames;
+
+   /* The time limits of every game, in milliseconds. */
+   long lMoveMillis;
+   long lGameMillis;
+
+   /* The processes of the players that stay alive between games, or
+      NULL if no player does. */
+   Pool_T oPool;
+
+   /* The file the records of the games are appended to, or NULL. */
+   Record_T oRecord;
+
+   /* The file the metrics are written to, or NULL, and the latencies
+      of each player so far if there is one. */
+   FILE *psMetrics;
+   struct Latency *psLatencies;
+
+   /* Guards iNext, the results, the metrics and stdout. */
+   pthread_mutex_t sLock;
+};
+
+/*--------------------------------------------------------------------*/
+/* Removes the newline and any trailing white space from pcLine. */
+
+static void trimLine(char *pcLine) {
+
+   size_t ulLength;
+
+   ulLength = strlen(pcLine);
+   while (ulLength > 0 && (pcLine[ulLength - 1] == '\n'
+                           || pcLine[ulLength - 1] == '\r'
+                           || pcLine[ulLength - 1] == ' '
+                           || pcLine[ulLength - 1] == '\t'))
+      pcLine[--ulLength] = '\0';
+}
+
+/*--------------------------------------------------------------------*/
+/* Reads the player names in the file pcPlayers into psTournament. A
+   name may be followed by "pool" if the player speaks the protocol of
+   a Pool, and then it is added to the pool of psTournament, and by
+   "binary" if the player is to be offered the binary protocol. Returns
+   1 if successful and 0 if not. */
+
+static int readPlayers(struct Tournament *psTournament,
+                       const char *pcPlayers) {
+
+   FILE *psFile;
+   char acLine[MAX_NAME];
+   char acName[MAX_NAME];
+   char aacFlags[2][MAX_NAME];
+   char **ppcNames;
+   int *piBinary;
+   int i, iFields;
+
+   psFile = fopen(pcPlayers, "r");
+   if (psFile == NULL) {perror(pcPlayers); return 0; }
+
+   while (fgets(acLine, MAX_NAME, psFile) != NULL) {
+      trimLine(acLine);
+      iFields = sscanf(acLine, "%255s %255s %255s", acName, aacFlags[0],
+                       aacFlags[1]);
+      if (iFields < 1) continue;
+      if (Game_checkPlayer(acName) == 0) {
+         fclose(psFile);
+         return 0;
+      }
+      ppcNames = realloc(psTournament->ppcNames,
+                         (size_t)(psTournament->iPlayers + 1)
+                         * sizeof(char *));
+      assert(ppcNames != NULL);
+      psTournament->ppcNames = ppcNames;
+      piBinary = realloc(psTournament->piBinary,
+                         (size_t)(psTournament->iPlayers + 1)
+                         * sizeof(int));
+      assert(piBinary != NULL);
+      psTournament->piBinary = piBinary;
+      piBinary[psTournament->iPlayers] = 0;
+      psTournament->ppcNames[psTournament->iPlayers] =
+         malloc(strlen(acName) + 1);
+      assert(psTournament->ppcNames[psTournament->iPlayers] != NULL);
+      strcpy(psTournament->ppcNames[psTournament->iPlayers], acName);
+
+      for (i = 0; i < iFields - 1; i++) {
+         if (strcmp(aacFlags[i], "binary") == 0)
+            piBinary[psTournament->iPlayers] = 1;
+         if (strcmp(aacFlags[i], "pool") != 0) continue;
+         if (psTournament->oPool == NULL) {
+            psTournament->oPool = Pool_new();
+            assert(psTournament->oPool != NULL);
+         }
+         Pool_addPlayer(psTournament->oPool, acName);
+      }
+      psTournament->iPlayers++;
+   }
+   fclose(psFile);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Returns the index of the player named pcName in psTournament, or -1
+   if there is none. */
+
+static int findPlayer(struct Tournament *psTournament,
+                      const char *pcName) {
+   int i;
+
+   for (i = 0; i < psTournament->iPlayers; i++)
+      if (strcmp(psTournament->ppcNames[i], pcName) == 0) return i;
+   return -1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Adds the game between the players iFirst and iSecond to the
+   schedule of psTournament. */
+
+static void addPairing(struct Tournament *psTournament, int iFirst,
+                       int iSecond) {
+
+   struct Pairing *psPairings;
+
+   psPairings = realloc(psTournament->psPairings,
+                        (size_t)(psTournament->iPairings + 1)
+                        * sizeof(struct Pairing));
+   assert(psPairings != NULL);
+   psTournament->psPairings = psPairings;
+   psPairings[psTournament->iPairings].iFirst = iFirst;
+   psPairings[psTournament->iPairings].iSecond = iSecond;
+   psPairings[psTournament->iPairings].iPlayed = 0;
+   psPairings[psTournament->iPairings].iScore = 0;
+   psTournament->iPairings++;
+}
+
+/*--------------------------------------------------------------------*/
+/* Reads the games in the file pcSchedule into psTournament, or makes
+   a double round robin if pcSchedule is NULL. Returns 1 if successful
+   and 0 if not. */
+
+static int readSchedule(struct Tournament *psTournament,
+                        const char *pcSchedule) {
+
+   FILE *psFile;
+   char acLine[2 * MAX_NAME];
+   char acFirst[MAX_NAME];
+   char acSecond[MAX_NAME];
+   int iFirst, iSecond, iLine;
+
+   if (pcSchedule == NULL) {
+      for (iFirst = 0; iFirst < psTournament->iPlayers; iFirst++)
+         for (iSecond = 0; iSecond < psTournament->iPlayers; iSecond++)
+            if (iFirst != iSecond)
+               addPairing(psTournament, iFirst, iSecond);
+      return 1;
+   }
+
+   psFile = fopen(pcSchedule, "r");
+   if (psFile == NULL) {perror(pcSchedule); return 0; }
+
+   for (iLine = 1; fgets(acLine, (int)sizeof(acLine), psFile) != NULL;
+        iLine++) {
+      trimLine(acLine);
+      if (acLine[0] == '\0') continue;
+      if (sscanf(acLine, "%255s %255s", acFirst, acSecond) != 2) {
+         fprintf(stderr, "%s:%d: expected two player names\n",
+                 pcSchedule, iLine);
+         fclose(psFile);
+         return 0;
+      }
+      iFirst = findPlayer(psTournament, acFirst);
+      iSecond = findPlayer(psTournament, acSecond);
+      if (iFirst == -1 || iSecond == -1) {
+         fprintf(stderr, "%s:%d: player %s is not in the player list\n",
+                 pcSchedule, iLine, iFirst == -1 ? acFirst : acSecond);
+         fclose(psFile);
+         return 0;
+      }
+      addPairing(psTournament, iFirst, iSecond);
+   }
+   fclose(psFile);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Takes the next game of the tournament pvTournament, stores it in
+   *ppvPairing and starts its match in *poMatch. Returns 0 if there
+   are no games left. */
+
+static int startGame(void *pvTournament, Match_T *poMatch,
+                     void **ppvPairing) {
+
+   struct Tournament *psTournament = pvTournament;
+   struct Pairing *psPairing;
+   int iGame;
+
+   pthread_mutex_lock(&psTournament->sLock);
+   iGame = psTournament->iNext;
+   if (iGame < psTournament->iPairings) psTournament->iNext++;
+   pthread_mutex_unlock(&psTournament->sLock);
+   if (iGame >= psTournament->iPairings) return 0;
+
+   psPairing = &psTournament->psPairings[iGame];
+   *ppvPairing = psPairing;
+   *poMatch = Match_new(psTournament->ppcNames[psPairing->iFirst],
+                        psTournament->ppcNames[psPairing->iSecond], 0,
+                        NULL, psTournament->lMoveMillis,
+                        psTournament->lGameMillis,
+                        psTournament->piBinary[psPairing->iFirst]
+                        | (psTournament->piBinary[psPairing->iSecond]
+                           << 1),
+                        psTournament->oPool, psTournament->oRecord);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+/* Adds the latencies of player (1 or 2) of oMatch to psLatency. */
+
+static void addLatency(struct Latency *psLatency, Match_T oMatch,
+                       int player) {
+   psLatency->iGames++;
+   Metrics_merge(&psLatency->sThink, Match_getThinkTimes(oMatch, player));
+   Metrics_merge(&psLatency->sReferee,
+                 Match_getRefereeTimes(oMatch, player));
+}
+
+/*--------------------------------------------------------------------*/
+/* Records the result of oMatch, the match of the game pvPairing of the
+   tournament pvTournament, and prints it. Writes its metrics if the
+   tournament has a metrics file. */
+
+static void finishGame(void *pvTournament, void *pvPairing,
+                       Match_T oMatch) {
+
+   struct Tournament *psTournament = pvTournament;
+   struct Pairing *psPairing = pvPairing;
+   char *player1, *player2;
+   int iGame;
+
+   iGame = (int)(psPairing - psTournament->psPairings);
+   player1 = psTournament->ppcNames[psPairing->iFirst];
+   player2 = psTournament->ppcNames[psPairing->iSecond];
+
+   pthread_mutex_lock(&psTournament->sLock);
+   if (oMatch != NULL) {
+      psPairing->iPlayed = 1;
+      psPairing->iScore = Match_getScore(oMatch);
+      printf("Game %d: FIRST (%s) vs SECOND (%s): %d\n", iGame + 1,
+             player1, player2, psPairing->iScore);
+      if (psTournament->psMetrics != NULL) {
+         Match_writeMetrics(oMatch, iGame + 1, psTournament->psMetrics);
+         addLatency(&psTournament->psLatencies[psPairing->iFirst],
+                    oMatch, 1);
+         addLatency(&psTournament->psLatencies[psPairing->iSecond],
+                    oMatch, 2);
+      }
+   }
+   else
+      printf("Game %d: FIRST (%s) vs SECOND (%s): not played\n",
+             iGame + 1, player1, player2);
+   fflush(stdout);
+   pthread_mutex_unlock(&psTournament->sLock);
+}
+
+/*--------------------------------------------------------------------*/
+/* Plays games of the tournament pvTournament, several at once, until
+   there are none left. Run by every worker thread. Returns NULL. */
+
+static void *playGames(void *pvTournament) {
+
+   struct Tournament *psTournament = pvTournament;
+
+   if (Mux_run(psTournament->iGames, startGame, finishGame,
+               psTournament) == 0)
+      perror("epoll");
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+/* Adds a game with score iScore, seen from psStanding's player, to
+   psStanding. */
+
+static void addResult(struct Standing *psStanding, int iScore) {
+   psStanding->iGames++;
+   psStanding->iDiscs += iScore;
+   if (iScore > 0) psStanding->iWins++;
+   else if (iScore < 0) psStanding->iLosses++;
+   else psStanding->iDraws++;
+}
+
+/*--------------------------------------------------------------------*/
+/* Orders the standings pvFirst and pvSecond by points, i.e. wins plus
+   half the draws, then by tiles. Returns a negative number if pvFirst
+   comes first, a positive one if pvSecond does, and 0 if tied. */
+
+static int compareStandings(const void *pvFirst, const void *pvSecond) {
+
+   const struct Standing *psFirst = pvFirst;
+   const struct Standing *psSecond = pvSecond;
+   int iPoints1, iPoints2;
+
+   iPoints1 = 2 * psFirst->iWins + psFirst->iDraws;
+   iPoints2 = 2 * psSecond->iWins + psSecond->iDraws;
+   if (iPoints1 != iPoints2) return iPoints2 - iPoints1;
+   if (psFirst->iDiscs != psSecond->iDiscs)
+      return psSecond->iDiscs - psFirst->iDiscs;
+   return psFirst->iPlayer - psSecond->iPlayer;
+}
+
+/*--------------------------------------------------------------------*/
+/* Prints the table of standings of psTournament to stdout. */
+
+static void printStandings(struct Tournament *psTournament) {
+
+   struct Standing *psStandings;
+   struct Pairing *psPairing;
+   int i;
+
+   psStandings = calloc((size_t)psTournament->iPlayers,
+                        sizeof(struct Standing));
+   assert(psStandings != NULL);
+   for (i = 0; i < psTournament->iPlayers; i++)
+      psStandings[i].iPlayer = i;
+
+   for (i = 0; i < psTournament->iPairings; i++) {
+      psPairing = &psTournament->psPairings[i];
+      if (psPairing->iPlayed == 0) continue;
+      addResult(&psStandings[psPairing->iFirst], psPairing->iScore);
+      addResult(&psStandings[psPairing->iSecond], -psPairing->iScore);
+   }
+   qsort(psStandings, (size_t)psTournament->iPlayers,
+         sizeof(struct Standing), compareStandings);
+
+   printf("\n%-24s %6s %6s %6s %6s %8s %7s\n", "Player", "Games",
+          "Wins", "Draws", "Losses", "Points", "Discs");
+   for (i = 0; i < psTournament->iPlayers; i++) {
+      printf("%-24s %6d %6d %6d %6d %8.1f %+7d\n",
+             psTournament->ppcNames[psStandings[i].iPlayer],
+             psStandings[i].iGames, psStandings[i].iWins,
+             psStandings[i].iDraws, psStandings[i].iLosses,
+             psStandings[i].iWins + psStandings[i].iDraws / 2.0,
+             psStandings[i].iDiscs);
+   }
+   free(psStandings);
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes a summary line of each kind of latency of psLatency, the
+   latencies of the player pcName, to psFile. */
+
+static void writeLatency(FILE *psFile, const char *pcName,
+                         const struct Latency *psLatency) {
+
+   char acPrefix[PREFIX_SIZE];
+
+   snprintf(acPrefix, sizeof(acPrefix),
+            "summary player=%s games=%d kind=think ", pcName,
+            psLatency->iGames);
+   Metrics_write(psFile, acPrefix, &psLatency->sThink);
+   snprintf(acPrefix, sizeof(acPrefix),
+            "summary player=%s games=%d kind=referee ", pcName,
+            psLatency->iGames);
+   Metrics_write(psFile, acPrefix, &psLatency->sReferee);
+}
+
+/*--------------------------------------------------------------------*/
+/* Writes the latencies of every player of psTournament, and of them
+   all together, to its metrics file. */
+
+static void writeLatencies(struct Tournament *psTournament) {
+
+   struct Latency *psTotal;
+   int i;
+
+   psTotal = calloc(1, sizeof(struct Latency));
+   assert(psTotal != NULL);
+   for (i = 0; i < psTournament->iPlayers; i++) {
+      writeLatency(psTournament->psMetrics, psTournament->ppcNames[i],
+                   &psTournament->psLatencies[i]);
+      Metrics_merge(&psTotal->sThink,
+                    &psTournament->psLatencies[i].sThink);
+      Metrics_merge(&psTotal->sReferee,
+                    &psTournament->psLatencies[i].sReferee);
+   }
+
+   /* Every game counts once, not once for each of its players. */
+   for (i = 0; i < psTournament->iPairings; i++)
+      psTotal->iGames += psTournament->psPairings[i].iPlayed;
+   writeLatency(psTournament->psMetrics, "*", psTotal);
+   free(psTotal);
+}
+
+/*--------------------------------------------------------------------*/
+/* Frees the memory of psTournament. */
+
+static void freeTournament(struct Tournament *psTournament) {
+
+   int i;
+
+   for (i = 0; i < psTournament->iPlayers; i++)
+      free(psTournament->ppcNames[i]);
+   free(psTournament->ppcNames);
+   free(psTournament->piBinary);
+   free(psTournament->psPairings);
+   free(psTournament->psLatencies);
+   if (psTournament->oPool != NULL) Pool_free(psTournament->oPool);
+}
+
+/*--------------------------------------------------------------------*/
+int Tournament_run(const char *pcPlayers, const char *pcSchedule,
+                   int iThreads, int iGames, long lMoveMillis,
+                   long lGameMillis, Record_T oRecord,
+                   FILE *psMetrics) {
+
+   struct Tournament sTournament;
+   pthread_t *psThreads;
+   int i;
+
+   assert(pcPlayers != NULL);
+
+   memset(&sTournament, 0, sizeof(sTournament));
+   if (readPlayers(&sTournament, pcPlayers) == 0
+       || readSchedule(&sTournament, pcSchedule) == 0) {
+      freeTournament(&sTournament);
+      return 0;
+   }
+
+   /* A player that crashes must not take the tournament down with it
+      when its moves are written. */
+   signal(SIGPIPE, SIG_IGN);
+
+   if (iThreads <= 0) iThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   if (iThreads <= 0) iThreads = 1;
+   if (iGames <= 0) iGames = 1;
+   if (iThreads > sTournament.iPairings) iThreads = sTournament.iPairings;
+   sTournament.iGames = iGames;
+   sTournament.lMoveMillis = lMoveMillis;
+   sTournament.lGameMillis = lGameMillis;
+   sTournament.oRecord = oRecord;
+   sTournament.psMetrics = psMetrics;
+   if (psMetrics != NULL) {
+      sTournament.psLatencies = calloc((size_t)sTournament.iPlayers,
+                                       sizeof(struct Latency));
+      assert(sTournament.psLatencies != NULL);
+   }
+
+   /* Start the workers and wait for them to play every game. */
+   pthread_mutex_init(&sTournament.sLock, NULL);
+   psThreads = calloc((size_t)iThreads + 1, sizeof(pthread_t));
+   assert(psThreads != NULL);
+   for (i = 0; i < iThreads; i++) {
+      if (pthread_create(&psThreads[i], NULL, playGames,
+                         &sTournament) != 0) {
+         perror("pthread_create");
+         break;
+      }
+   }
+   iThreads = i;
+   if (iThreads == 0) playGames(&sTournament);
+   for (i = 0; i < iThreads; i++) pthread_join(psThreads[i], NULL);
+   free(psThreads);
+   pthread_mutex_destroy(&sTournament.sLock);
+
+   printStandings(&sTournament);
+   if (psMetrics != NULL) writeLatencies(&sTournament);
+   freeTournament(&sTournament);
+   return 1;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,35 @@
+/*--------------------------------------------------------------------*/
+/* tournament.h                                                       */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef TOURNAMENT_INCLUDED
+#define TOURNAMENT_INCLUDED
+
+#include <stdio.h>
+#include "record.h"
+
+/* Plays a tournament between the player files named in the file
+   pcPlayers, one per line. A name followed by "pool" is a player that
+   speaks the protocol of pool.h, and its processes are kept alive and
+   used again from game to game. A name followed by "binary" is a
+   player that is offered the binary protocol of protocol.h. Either
+   can follow the other. The file pcSchedule lists the games,
+   one per line as the names of the FIRST and the SECOND player. If
+   pcSchedule is NULL every player plays every other player once as
+   FIRST and once as SECOND. The games are played on a pool of
+   iThreads worker threads, or one per processor if iThreads is 0, and
+   each worker keeps iGames of them going at once (1 if iGames is 0).
+   Every game has the time limits lMoveMillis and lGameMillis of
+   Game_play, and its record is appended to oRecord unless it is NULL.
+   Prints the result of each game as it ends and then a table of the
+   standings to stdout. Unless psMetrics is NULL, writes the latency
+   histograms of each game to it as the game ends (see
+   Match_writeMetrics), and at the end a summary line of each kind for
+   each player over all its games and for all the players together,
+   named "*". Returns 1 if successful and 0 if the files cannot be
+   read or name players that cannot be run. */
+int Tournament_run(const char *pcPlayers, const char *pcSchedule,
+                   int iThreads, int iGames, long lMoveMillis,
+                   long lGameMillis, Record_T oRecord, FILE *psMetrics);
+
+#endif
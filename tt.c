@@ -0,0 +1,179 @@
+/*--------------------------------------------------------------------*/
+/* tt.c                                                               */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "tt.h"
+
+/* Number of bytes in a cache line, i.e. in a bucket. */
+enum {CACHE_LINE = 64};
+
+/* Number of entries in a bucket. */
+enum {BUCKET_ENTRIES = 4};
+
+/* Where the fields of an entry sit in its data word. */
+enum {MOVE_SHIFT = 32, DEPTH_SHIFT = 40, BOUND_SHIFT = 48,
+      AGE_SHIFT = 56};
+
+/* Every entry word is read and written whole, so that threads never
+   see half of one. Which words belong together is checked with the
+   hash. */
+#ifdef __GNUC__
+#define TT_LOAD(pu) __atomic_load_n((pu), __ATOMIC_RELAXED)
+#define TT_STORE(pu, u) __atomic_store_n((pu), (u), __ATOMIC_RELAXED)
+#else
+#define TT_LOAD(pu) (*(volatile uint64_t *)(pu))
+#define TT_STORE(pu, u) (*(volatile uint64_t *)(pu) = (u))
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* A bucket of entries that fills one cache line. Entry i is the pair
+   of words auWord[2i], the hash exclusive or the data, and
+   auWord[2i + 1], the data. An empty entry is all zeros. */
+struct Bucket {
+   uint64_t auWord[2 * BUCKET_ENTRIES];
+};
+
+struct TT {
+   /* The buckets, aligned to a cache line. */
+   struct Bucket *psBuckets;
+
+   /* The memory allocated for the buckets. */
+   void *pvMemory;
+
+   /* The number of buckets - 1. The number of buckets is a power of
+      two, so that the low bits of a hash pick its bucket. */
+   uint64_t uMask;
+
+   /* The age of the current search. */
+   unsigned age;
+};
+
+/*--------------------------------------------------------------------*/
+/* Returns psEntry packed into a data word of age uAge. */
+
+static uint64_t TT_pack(const struct TT_Entry *psEntry, unsigned uAge) {
+   return (uint64_t)(uint32_t)psEntry->score
+      | (uint64_t)psEntry->move << MOVE_SHIFT
+      | (uint64_t)psEntry->depth << DEPTH_SHIFT
+      | (uint64_t)(psEntry->bound & 3) << BOUND_SHIFT
+      | (uint64_t)(uAge & 0xFF) << AGE_SHIFT;
+}
+
+/*--------------------------------------------------------------------*/
+TT_T TT_new(size_t ulBytes) {
+
+   TT_T oTT;
+   uint64_t uBuckets;
+
+   oTT = (TT_T)calloc(1, sizeof(struct TT));
+   if (oTT == NULL) return NULL;
+
+   /* Use the largest power of two buckets that fits. */
+   uBuckets = 1;
+   while (uBuckets * 2 * sizeof(struct Bucket) <= ulBytes) uBuckets *= 2;
+
+   oTT->pvMemory = calloc((size_t)uBuckets * sizeof(struct Bucket)
+                          + CACHE_LINE, 1);
+   if (oTT->pvMemory == NULL) {
+      free(oTT);
+      return NULL;
+   }
+   oTT->psBuckets = (struct Bucket *)(((uintptr_t)oTT->pvMemory
+                                       + CACHE_LINE - 1)
+                                      & ~(uintptr_t)(CACHE_LINE - 1));
+   oTT->uMask = uBuckets - 1;
+   oTT->age = 0;
+   return oTT;
+}
+
+/*--------------------------------------------------------------------*/
+void TT_free(TT_T oTT) {
+   if (oTT == NULL) return;
+   free(oTT->pvMemory);
+   free(oTT);
+}
+
+/*--------------------------------------------------------------------*/
+void TT_clear(TT_T oTT) {
+   assert(oTT != NULL);
+   memset(oTT->psBuckets, 0,
+          (size_t)(oTT->uMask + 1) * sizeof(struct Bucket));
+   oTT->age = 0;
+}
+
+/*--------------------------------------------------------------------*/
+void TT_newSearch(TT_T oTT) {
+   assert(oTT != NULL);
+   oTT->age = (oTT->age + 1) & 0xFF;
+}
+
+/*--------------------------------------------------------------------*/
+void TT_store(TT_T oTT, uint64_t uHash, const struct TT_Entry *psEntry) {
+
+   struct Bucket *psBucket;
+   uint64_t uData, uKey;
+   int i, iVictim, iWorth, iLeast;
+
+   assert(oTT != NULL);
+   assert(psEntry != NULL);
+
+   psBucket = &oTT->psBuckets[uHash & oTT->uMask];
+
+   /* Replace the entry of the same board if there is one. Otherwise
+      replace an empty entry, or else the one that is least worth
+      keeping: entries of earlier searches first, then the shallowest.
+      */
+   iVictim = 0;
+   iLeast = 1 << 30;
+   for (i = 0; i < BUCKET_ENTRIES; i++) {
+      uData = TT_LOAD(&psBucket->auWord[2 * i + 1]);
+      uKey = TT_LOAD(&psBucket->auWord[2 * i]) ^ uData;
+      if (uKey == uHash) {
+         iVictim = i;
+         break;
+      }
+      iWorth = (int)((uData >> DEPTH_SHIFT) & 0xFF);
+      if (((uData >> BOUND_SHIFT) & 3) == 0) iWorth = -1;
+      else if (((uData >> AGE_SHIFT) & 0xFF) == oTT->age) iWorth += 256;
+      if (iWorth < iLeast) {
+         iLeast = iWorth;
+         iVictim = i;
+      }
+   }
+
+   uData = TT_pack(psEntry, oTT->age);
+   TT_STORE(&psBucket->auWord[2 * iVictim], uHash ^ uData);
+   TT_STORE(&psBucket->auWord[2 * iVictim + 1], uData);
+}
+
+/*--------------------------------------------------------------------*/
+int TT_probe(TT_T oTT, uint64_t uHash, struct TT_Entry *psEntry) {
+
+   struct Bucket *psBucket;
+   uint64_t uData;
+   int i;
+
+   assert(oTT != NULL);
+   assert(psEntry != NULL);
+
+   psBucket = &oTT->psBuckets[uHash & oTT->uMask];
+   for (i = 0; i < BUCKET_ENTRIES; i++) {
+      uData = TT_LOAD(&psBucket->auWord[2 * i + 1]);
+      if ((TT_LOAD(&psBucket->auWord[2 * i]) ^ uData) != uHash)
+         continue;
+      if (((uData >> BOUND_SHIFT) & 3) == 0) continue;
+
+      psEntry->score = (int32_t)(uint32_t)(uData & 0xFFFFFFFFu);
+      psEntry->move = (uint8_t)(uData >> MOVE_SHIFT);
+      psEntry->depth = (uint8_t)(uData >> DEPTH_SHIFT);
+      psEntry->bound = (uint8_t)((uData >> BOUND_SHIFT) & 3);
+      return 1;
+   }
+   return 0;
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,66 @@
+/*--------------------------------------------------------------------*/
+/* tt.h                                                               */
+/* Author: Ally Dalman                                                */
+/*--------------------------------------------------------------------*/
+#ifndef TT_INCLUDED
+#define TT_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A TT is a transposition table: a fixed-size table of search results
+   found by the hash of the board they belong to. Entries are kept in
+   buckets of one cache line each. Any number of threads can store and
+   probe the same TT at once without locks: every entry is checked
+   against its hash on the way out, so a probe never returns an entry
+   that another thread was halfway through writing. */
+
+typedef struct TT *TT_T;
+
+/* The kinds of score an entry can hold: an exact score, a score that
+   is at least the true score (the search failed high), or at most the
+   true score (the search failed low). */
+enum TT_Bound {TT_EXACT = 1, TT_LOWER = 2, TT_UPPER = 3};
+
+/* No move stored in an entry. */
+enum {TT_NO_MOVE = 255};
+
+/* An entry of a TT. */
+struct TT_Entry {
+   /* The score of the board. */
+   int32_t score;
+
+   /* The best move found, i.e. row * 8 + column, or TT_NO_MOVE. */
+   uint8_t move;
+
+   /* The number of moves the search looked ahead. */
+   uint8_t depth;
+
+   /* The kind of score, an enum TT_Bound. */
+   uint8_t bound;
+};
+
+/* Creates a new TT that takes up about ulBytes bytes of memory.
+   Returns the TT, or NULL if there is not enough memory. */
+TT_T TT_new(size_t ulBytes);
+
+/* Frees oTT. */
+void TT_free(TT_T oTT);
+
+/* Empties oTT. Must not be called while other threads use it. */
+void TT_clear(TT_T oTT);
+
+/* Marks the entries of oTT as older than the ones stored from now on,
+   which are preferred over them when a bucket is full. Call it at the
+   start of every new search. */
+void TT_newSearch(TT_T oTT);
+
+/* Stores psEntry for the board with hash uHash in oTT, replacing
+   another entry of the same bucket if it is full. */
+void TT_store(TT_T oTT, uint64_t uHash, const struct TT_Entry *psEntry);
+
+/* Looks for the board with hash uHash in oTT. Stores its entry in
+   *psEntry and returns 1 if it is found, and returns 0 if not. */
+int TT_probe(TT_T oTT, uint64_t uHash, struct TT_Entry *psEntry);
+
+#endif